@@ -40,10 +40,15 @@
 
 #ifndef SPRITE_OFF
 	#include <t2kSprite.h>
+	#include <t2kSpritePattern.h>
 
-	//#ifndef COLLISION_OFF
-	//	#include <t2kCollision.h>
-	//#endif
+	#ifndef COLLISION_OFF
+		#include <t2kCollision.h>
+	#endif
+
+	#ifndef TILEMAP_OFF
+		#include <t2kTilemap.h>
+	#endif
 #endif
 
 #ifndef GRAPHICS_OFF
@@ -0,0 +1,43 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft 
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+#ifndef __T2K_COLLISION_H__
+#define __T2K_COLLISION_H__
+
+#include <t2kSprite.h>
+
+// pixel-perfect hit test with the collision masks made by t2kBuildCollisionMask
+// (or t2kSpriteConv/T2K_ASCII_SPRITE). if a sprite has no mask, the bounding
+// boxes are tested. (inXA,inYA) and (inXB,inYB) are the same positions as t2kPutSprite.
+bool t2kHitTest(const T2K_Sprite16colors *inSpriteA,int inXA,int inYA,
+				const T2K_Sprite16colors *inSpriteB,int inXB,int inYB);
+bool t2kHitTestFrame(const T2K_Sprite16colors *inSpriteA,int inFrameA,int inXA,int inYA,
+					 const T2K_Sprite16colors *inSpriteB,int inFrameB,int inXB,int inYB);
+
+// broad phase: uniform grid over GRAM (16x16 pixels per cell).
+// add all objects for each frame, and t2kCollisionGridFindPairs reports the
+// pairs whose bounding boxes overlap. a pair is tested only if
+// (categoryA & maskB)!=0 || (categoryB & maskA)!=0.
+// objects out of GRAM are put in the cells at the edge.
+typedef void (*T2K_CollisionPairCallback)(int inIdA,int inIdB,void *ioContext);
+
+bool t2kCollisionGridInit(int inMaxObjects);
+void t2kCollisionGridClear();
+int t2kCollisionGridAdd(int inLeft,int inTop,int inRight,int inBottom,
+						uint8_t inCategory=1,uint8_t inMask=0xFF);	// return id or -1
+int t2kCollisionGridAddSprite(const T2K_Sprite16colors *inSprite,int inX,int inY,
+							  uint8_t inCategory=1,uint8_t inMask=0xFF);
+int t2kCollisionGridFindPairs(T2K_CollisionPairCallback inCallback,void *ioContext);
+
+#endif
@@ -19,6 +19,23 @@ struct Font {
 	uint8_t pattern[8];
 };
 
+// packed font: glyphs of any size (width<=32) with their own advance.
+// the rows of a glyph are bit packed (MSB first, no padding between rows)
+// from bitmap[offset].
+struct T2K_PackedGlyph {
+	uint16_t offset;			// in T2K_PackedFont::bitmap
+	uint8_t width,height;
+	int8_t offsetY;				// from the top of the line
+	uint8_t advance;			// to the next char
+};
+struct T2K_PackedFont {
+	uint8_t firstChar,lastChar;
+	uint8_t defaultChar;		// drawn for the chars out of [firstChar,lastChar]
+	uint8_t lineHeight;
+	const T2K_PackedGlyph *glyphs;	// lastChar-firstChar+1 glyphs
+	const uint8_t *bitmap;
+};
+
 #ifndef T2K_DO_NOT_DEFINE_FONT
 const Font kComputerfontFace[96]={
 	{ 0x00,0x00,0x00,0x00, 0x00,0x00,0x00,0x00 },	// space
@@ -145,13 +162,177 @@ const uint8_t T2K_TrianglePatternRight[8]={
 
 #endif
 
+#ifndef T2K_DO_NOT_DEFINE_PACKED_FONT
+// proportional version of kComputerfontFace (the empty columns and rows are trimmed).
+const T2K_PackedGlyph kComputerfontFacePGlyphs[96]={
+	{   0, 0,0, 0, 4 },	// space
+	{   0, 3,7, 0, 4 },	// !
+	{   3, 7,3, 0, 8 },	// "
+	{   6, 7,7, 0, 8 },	// #
+	{  13, 7,7, 0, 8 },	// $
+	{  20, 7,7, 0, 8 },	// %
+	{  27, 7,7, 0, 8 },	// &
+	{  34, 3,3, 0, 4 },	// '
+	{  36, 5,7, 0, 6 },	// (
+	{  41, 5,7, 0, 6 },	// )
+	{  46, 7,7, 0, 8 },	// *
+	{  53, 7,7, 0, 8 },	// +
+	{  60, 2,3, 4, 3 },	// ,
+	{  61, 6,1, 3, 7 },	// -
+	{  62, 3,2, 5, 4 },	// .
+	{  63, 7,7, 0, 8 },	// /
+	{  70, 7,7, 0, 8 },	// 0
+	{  77, 3,7, 0, 4 },	// 1
+	{  80, 7,7, 0, 8 },	// 2
+	{  87, 7,7, 0, 8 },	// 3
+	{  94, 7,7, 0, 8 },	// 4
+	{ 101, 7,7, 0, 8 },	// 5
+	{ 108, 7,7, 0, 8 },	// 6
+	{ 115, 7,7, 0, 8 },	// 7
+	{ 122, 7,7, 0, 8 },	// 8
+	{ 129, 7,7, 0, 8 },	// 9
+	{ 136, 2,6, 0, 3 },	// :
+	{ 138, 2,7, 0, 3 },	// ;
+	{ 140, 5,7, 0, 6 },	// <
+	{ 145, 6,4, 1, 7 },	// =
+	{ 148, 5,7, 0, 6 },	// >
+	{ 153, 7,7, 0, 8 },	// ?
+	{ 160, 7,7, 0, 8 },	// @
+	{ 167, 7,7, 1, 8 },	// A
+	{ 174, 7,7, 1, 8 },	// B
+	{ 181, 7,7, 1, 8 },	// C
+	{ 188, 7,7, 1, 8 },	// D
+	{ 195, 7,7, 1, 8 },	// E
+	{ 202, 7,7, 1, 8 },	// F
+	{ 209, 7,7, 1, 8 },	// G
+	{ 216, 7,7, 1, 8 },	// H
+	{ 223, 3,7, 1, 4 },	// I
+	{ 226, 7,7, 1, 8 },	// J
+	{ 233, 7,7, 1, 8 },	// K
+	{ 240, 7,7, 1, 8 },	// L
+	{ 247, 7,7, 1, 8 },	// M
+	{ 254, 7,7, 1, 8 },	// N
+	{ 261, 7,7, 1, 8 },	// O
+	{ 268, 7,7, 1, 8 },	// P
+	{ 275, 7,7, 1, 8 },	// Q
+	{ 282, 7,7, 1, 8 },	// R
+	{ 289, 7,7, 1, 8 },	// S
+	{ 296, 7,7, 1, 8 },	// T
+	{ 303, 7,7, 1, 8 },	// U
+	{ 310, 7,7, 1, 8 },	// V
+	{ 317, 7,7, 1, 8 },	// W
+	{ 324, 7,7, 1, 8 },	// X
+	{ 331, 7,7, 1, 8 },	// Y
+	{ 338, 7,7, 1, 8 },	// Z
+	{ 345, 3,7, 1, 4 },	// [
+	{ 348, 7,7, 1, 8 },	// back slash
+	{ 355, 3,7, 1, 4 },	// ]
+	{ 358, 4,2, 1, 5 },	// ^
+	{ 359, 7,1, 7, 8 },	// _
+	{ 360, 3,2, 1, 4 },	// `
+	{ 361, 6,6, 2, 7 },	// a
+	{ 366, 5,7, 1, 6 },	// b
+	{ 371, 5,5, 3, 6 },	// c
+	{ 375, 5,7, 1, 6 },	// d
+	{ 380, 6,6, 2, 7 },	// e
+	{ 385, 5,7, 1, 6 },	// f
+	{ 390, 5,6, 2, 6 },	// g
+	{ 394, 5,7, 1, 6 },	// h
+	{ 399, 2,7, 1, 3 },	// i
+	{ 401, 4,7, 1, 5 },	// j
+	{ 405, 5,7, 1, 6 },	// k
+	{ 410, 3,7, 1, 4 },	// l
+	{ 413, 7,6, 2, 8 },	// m
+	{ 419, 5,6, 2, 6 },	// n
+	{ 423, 5,6, 2, 6 },	// o
+	{ 427, 5,7, 1, 6 },	// p
+	{ 432, 5,7, 1, 6 },	// q
+	{ 437, 5,5, 1, 6 },	// r
+	{ 441, 5,7, 1, 6 },	// s
+	{ 446, 5,6, 1, 6 },	// t
+	{ 450, 5,5, 2, 6 },	// u
+	{ 454, 5,5, 2, 6 },	// v
+	{ 458, 7,5, 2, 8 },	// w
+	{ 463, 5,5, 2, 6 },	// x
+	{ 467, 5,6, 2, 6 },	// y
+	{ 471, 5,6, 2, 6 },	// z
+	{ 475, 4,7, 1, 5 },	// {
+	{ 479, 1,7, 1, 2 },	// |
+	{ 480, 4,7, 1, 5 },	// }
+	{ 484, 7,3, 3, 8 },	// ~
+	{ 487, 8,8, 0, 9 },	// for undefined char
+};
+const uint8_t kComputerfontFacePBitmap[495]={
+	0xDB,0x7E,0x38,0xEF,0xDC,0x88,0x4C,0x9B,0xFA,0x64,0xDF,0xD3,
+	0x00,0x11,0xFF,0x49,0xC9,0xFF,0xC4,0x00,0xE3,0xC4,0x0F,0xFE,
+	0x1D,0xFB,0x80,0x78,0xC1,0x97,0xFE,0x5C,0xBF,0x00,0xFC,0x80,
+	0x7E,0x31,0xCE,0x71,0xE0,0xF0,0xC6,0x73,0x9F,0xC0,0x11,0xAF,
+	0x59,0xED,0x7A,0xC4,0x00,0x10,0x20,0x47,0xF1,0x02,0x04,0x00,
+	0xF4,0xFC,0xFC,0x06,0x0C,0x1F,0xFE,0x1C,0x38,0x00,0xFF,0x0E,
+	0x1C,0x78,0xF1,0xFF,0x80,0x6D,0xFF,0xF8,0xFF,0x0C,0x1F,0xFE,
+	0x1C,0x7F,0x80,0xFD,0x18,0x33,0xF0,0xF1,0xFF,0x80,0x8D,0x1A,
+	0x37,0xF1,0xC3,0x87,0x00,0xFF,0x83,0x07,0xF0,0xF1,0xFF,0x80,
+	0xFF,0x0E,0x07,0xF8,0xF1,0xFF,0x80,0xFF,0x0C,0x18,0x70,0xE1,
+	0xC3,0x80,0x7C,0x99,0x37,0xF8,0xF1,0xFF,0x80,0xFF,0x0E,0x1F,
+	0xF0,0xE1,0xC3,0x80,0xF0,0xF0,0xF0,0xF4,0x19,0x99,0x86,0x18,
+	0x60,0xFC,0x00,0x3F,0xC3,0x0C,0x33,0x33,0x00,0xFF,0x0C,0x19,
+	0xF3,0x80,0x0E,0x00,0xFF,0x06,0x6E,0xDD,0xF8,0x3F,0x80,0x7C,
+	0xE9,0xD7,0xFE,0x3C,0x78,0x80,0xFD,0x8B,0x17,0xFE,0x3C,0x7F,
+	0x80,0xFF,0x87,0x07,0x0E,0x1C,0x7F,0x80,0xFF,0x87,0x0F,0x1E,
+	0x3C,0x7F,0x80,0xFF,0x83,0x07,0xFE,0x1C,0x3F,0x80,0xFF,0x83,
+	0x07,0xFE,0x1C,0x38,0x00,0xFF,0x87,0x07,0x3E,0x3C,0x7F,0x80,
+	0xC3,0x87,0x0F,0xFE,0x3C,0x78,0x80,0xDB,0x7F,0xF8,0x0C,0x18,
+	0x30,0x78,0xF1,0xFF,0x80,0xC7,0x9B,0x67,0x8F,0x9D,0xB9,0x80,
+	0xC1,0x83,0x07,0x0E,0x1C,0x3F,0x80,0xFF,0x97,0x2F,0x5E,0xBD,
+	0x7A,0x80,0xFF,0x87,0x0F,0x1E,0x3C,0x78,0x80,0xFF,0x1E,0x3C,
+	0x78,0x70,0xFF,0x80,0xFF,0x87,0x0F,0xFE,0x1C,0x38,0x00,0xFF,
+	0x0E,0x1C,0x38,0x71,0xFF,0x80,0xFD,0x8B,0x16,0x6F,0x9D,0xB9,
+	0x80,0xFF,0x87,0x07,0xF0,0xF1,0xFF,0x80,0xFE,0x60,0xC1,0xC3,
+	0x87,0x0E,0x00,0xC3,0x87,0x0F,0x1E,0x3C,0x7F,0x80,0xE3,0xC7,
+	0x8F,0x16,0x6C,0x9F,0x00,0xCB,0x97,0x2F,0x5E,0xBD,0x7F,0x80,
+	0xC3,0x85,0x91,0xC7,0x5C,0x78,0x80,0x83,0x06,0x0F,0xF3,0x87,
+	0x0E,0x00,0xFF,0x1C,0xF3,0x8E,0x1C,0x7F,0x80,0xF2,0x49,0x38,
+	0xC1,0x83,0x07,0xF0,0xE1,0xC3,0x80,0xE4,0x92,0x78,0xF9,0xFE,
+	0xE4,0xFA,0x20,0xBF,0xCF,0xF0,0x84,0x3F,0x1C,0xE7,0xE0,0xFC,
+	0x71,0x9F,0x80,0x08,0x7F,0x19,0xCF,0xE0,0xFF,0x1F,0xF0,0xE7,
+	0xF0,0x39,0x3E,0x43,0x18,0xC0,0xFE,0x7B,0xF0,0xFC,0x84,0x3F,
+	0x1C,0xE7,0x20,0x8A,0xFC,0x20,0x23,0x33,0xE0,0x42,0x17,0x6E,
+	0x7B,0x60,0xD9,0x26,0xD8,0xFF,0x26,0x4E,0xDD,0xBB,0x40,0xFC,
+	0x63,0x9C,0xE4,0xFC,0x63,0x9C,0xFC,0xFC,0x73,0x9F,0xC2,0x00,
+	0xFC,0x73,0x9F,0x84,0x20,0xFC,0x31,0x8C,0x00,0xFE,0x71,0xF1,
+	0xCF,0xE0,0x27,0xC8,0x63,0x18,0x8C,0x73,0x9F,0x80,0xCE,0x76,
+	0xA7,0x00,0x93,0x27,0x6E,0xDF,0xE0,0x8C,0x5D,0x9C,0x80,0xCE,
+	0x63,0xF0,0xFC,0xFC,0x4F,0xCC,0xFC,0x76,0x6C,0x66,0x70,0xFE,
+	0xE6,0x63,0x66,0xE0,0x07,0xFD,0xC0,0xFF,0x81,0x81,0x81,0x81,
+	0x81,0x81,0xFF,
+};
+const T2K_PackedFont kComputerfontFaceP={
+	' ',0x7F,0x7F,8,kComputerfontFacePGlyphs,kComputerfontFacePBitmap
+};
+#endif
+
+// glyph set of the chars out of ASCII (e.g. kana and kanji), made by
+// tools/t2kGlyphConv. the strings are UTF-8, and the glyphs are decompressed
+// when they are drawn (at most 9 bytes each, on the stack of the caller).
+// for the texts drawn in every frame, T2K_TextLayer keeps them rendered.
+struct T2K_GlyphSet {
+	uint16_t numOfGlyphs;
+	const uint16_t *codepoints;	// sorted
+	const uint16_t *offsets;	// of the glyphs in data
+	const uint8_t *data;		// compressed 8x8 patterns
+};
+void t2kSetGlyphSet(const T2K_GlyphSet *inGlyphSet);
+
 void t2kPutChar(int inX,int inY,uint8_t inRGB332,char inChar);
+void t2kPutCodepoint(int inX,int inY,uint8_t inRGB332,uint32_t inCodepoint);
 void t2kPutStr(int inX,int inY,uint8_t inRGB332,const char *inString);
+int t2kGetStrLength(const char *inString);	// num of chars (not bytes)
 
 // NOTE:
-// The actual length of the output string should not exceed 255 characters
-// (the internal buffer length is only 256 bytes, including the null-terminated string).
-// Also, since there is only one internal buffer, this function is NOT thread-safe.
+// The output string is cut at 255 characters (it is formatted in a 256 bytes
+// buffer on the stack, and the glyphs of the glyph set are decompressed there
+// too, so this function can be called from both cores).
+// For the texts drawn in every frame, T2K_Text and t2kPutInt are faster.
 void t2kPrintf(int inX,int inY,uint8_t inRGB332,const char *inFormat,...);
 
 // centering
@@ -159,5 +340,71 @@ void t2kPrintf(int inY,uint8_t inRGB332,const char *inFormat,...);
 
 void t2kDrawFontPattern(int inX,int inY,uint8_t inRGB332,const uint8_t *inPattern);
 
+// numbers drawn without a string (inWidth is the min num of chars,
+// inPad is ' ' or '0', e.g. t2kPutInt(x,y,c,score,7,'0') is "%07d").
+// inValue of t2kPutFixed has inFracBits fraction bits and is rounded to
+// inNumOfDecimals digits (e.g. 0x18000,16,2 is "1.50").
+void t2kPutInt(int inX,int inY,uint8_t inRGB332,int32_t inValue,
+			   int inWidth=0,char inPad=' ');
+void t2kPutFixed(int inX,int inY,uint8_t inRGB332,int32_t inValue,int inFracBits,
+				 int inNumOfDecimals,int inWidth=0,char inPad=' ');
+
+// text builder on a buffer of the caller (on the stack etc.), no malloc and
+// no global state. the text is cut to fit the buffer.
+//	char buf[32];
+//	T2K_Text text;
+//	t2kTextInit(&text,buf,sizeof(buf));
+//	t2kTextAddStr(&text,"SCORE ");
+//	t2kTextAddInt(&text,gScore,7,'0');
+//	t2kPutText(4,4,kWhite,&text);
+struct T2K_Text {
+	char *buffer;
+	uint16_t size;		// of the buffer (including '\0')
+	uint16_t length;
+};
+void t2kTextInit(T2K_Text *outText,char *inBuffer,int inSize);
+void t2kTextClear(T2K_Text *ioText);
+void t2kTextAddChar(T2K_Text *ioText,char inChar);
+void t2kTextAddStr(T2K_Text *ioText,const char *inString);
+void t2kTextAddInt(T2K_Text *ioText,int32_t inValue,int inWidth=0,char inPad=' ');
+void t2kTextAddHex(T2K_Text *ioText,uint32_t inValue,int inWidth=0,char inPad='0');
+void t2kTextAddFixed(T2K_Text *ioText,int32_t inValue,int inFracBits,int inNumOfDecimals,
+					 int inWidth=0,char inPad=' ');
+void t2kTextPrintf(T2K_Text *ioText,const char *inFormat,...);	// bounded vsnprintf
+void t2kPutText(int inX,int inY,uint8_t inRGB332,const T2K_Text *inText);
+
+// text layer: a string rendered once with the 8x8 font and drawn as a
+// bitmap in every frame (for static labels). t2kSetTextLayer renders the
+// string only if the string (compared with the rendered chars), the colors,
+// the font (t2kFontInit) or the glyph set (t2kSetGlyphSet) are changed.
+//	transparent layer: 1 bit per pixel, drawn in fgColor.
+//	opaque layer: RGB332 per pixel with bgColor, drawn by row copies.
+struct T2K_TextLayer {
+	uint8_t *surface;			// 8 rows of maxLength chars
+	uint8_t maxLength;
+	uint8_t length;				// num of chars rendered
+	bool isOpaque;
+	bool surface_needToFree;	// true if surface is created by malloc.
+	uint8_t fgColor,bgColor;
+	uint8_t *chars;				// rendered chars (2 bytes each), after the surface
+	uint8_t glyphGeneration;	// of the font and the glyph set rendered with
+};
+// inSurfaceArea should have inMaxLength*10 bytes (transparent) or
+// inMaxLength*66 bytes (opaque), the surface and the rendered chars.
+// NULL means malloc.
+bool t2kInitTextLayer(T2K_TextLayer *outLayer,int inMaxLength,bool inIsOpaque=false,
+					  uint8_t *inSurfaceArea=NULL);
+void t2kFreeTextLayer(T2K_TextLayer *ioLayer);
+bool t2kSetTextLayer(T2K_TextLayer *ioLayer,const char *inString,	// true if rendered
+					 uint8_t inRGB332,uint8_t inBgRGB332=0);
+void t2kPutTextLayer(const T2K_TextLayer *inLayer,int inX,int inY);
+int t2kGetTextLayerWidth(const T2K_TextLayer *inLayer);
+
+// packed fonts. return the advance (the width of the drawn string).
+int t2kPutPackedChar(const T2K_PackedFont *inFont,int inX,int inY,uint8_t inRGB332,char inChar);
+int t2kPutPackedStr(const T2K_PackedFont *inFont,int inX,int inY,uint8_t inRGB332,
+					const char *inString);
+int t2kGetPackedStrWidth(const T2K_PackedFont *inFont,const char *inString);
+
 #endif
 
@@ -22,10 +22,17 @@
 
 bool t2kMmlInit();
 bool t2kCheckMML(const char *inMmlString);
+bool t2kCacheMML(const char *inMmlString);
 bool t2kPlayMML(uint8_t inChannel,const char *inMmlString);
 bool t2kStopMML(uint8_t inChannel);
 void t2kStopMMLs();
 void t2kUpdateMML();
 
+// t2kSeekMML finds the nearest of 32 snapshots by a binary search, then parses
+// the song from there (up to 1/32 of the song). the positions after the end
+// of a song with '$' are wrapped at '$' (also by t2kGetMMLPosition).
+bool t2kSeekMML(uint8_t inChannel,uint32_t inMSec);
+int32_t t2kGetMMLPosition(uint8_t inChannel);	// [msec]
+
 #endif
 
@@ -21,13 +21,39 @@
 const int kNumOfChannels=4;
 const int kAllChannels=-1;
 
+// pitch modulation for t2kAddToneEx.
+// set 0 to the parameters of unused effects.
+struct T2K_ToneModulation {
+	float vibratoDepthCents;	// 100 cents == a semitone.
+	float vibratoRateHz;
+	float portamentoFromHz;		// slide from this freq to the tone freq.
+	int16_t portamentoMSec;
+	int8_t arpeggio[2];			// semitones. played as tone,+[0],+[1],tone,...
+	int16_t arpeggioMSec;		// length of each arpeggio step.
+};
+
+// offline renderer for t2kPlayPCM (see t2kCacheMML).
+struct T2K_PCMRenderer {
+	int8_t *buffer;			// malloc'ed by t2kInitPCMRenderer. owned by the caller.
+	uint32_t capacity;		// num of samples
+	uint32_t length;		// num of rendered samples
+	float theta;
+};
+
 bool t2kSCoreInit();
 void t2kSCoreStart();
 bool t2kSetMasterVolume(int8_t inChannel,uint8_t inVolume);
 bool t2kTone(uint8_t inChannel,float inFreq,int16_t inDurationMSec,uint8_t inVolume);
 bool t2kAddTone(uint8_t inChannel,float inFreq,int16_t inDurationMSec,uint8_t inVolume);
+bool t2kAddToneEx(uint8_t inChannel,float inFreq,int16_t inDurationMSec,uint8_t inVolume,
+				  const T2K_ToneModulation *inModulation);
 bool t2kStartToneSeq(uint8_t inChannel);
 bool t2kClearToneSeq(uint8_t inChannel);
+uint32_t t2kGetToneSeqPlayedMSec(uint8_t inChannel);
+bool t2kPlayPCM(uint8_t inChannel,const int8_t *inPCM,uint32_t inLength);
+bool t2kInitPCMRenderer(T2K_PCMRenderer *outRenderer,uint32_t inMSec);
+bool t2kRenderTone(T2K_PCMRenderer *ioRenderer,float inFreq,int16_t inDurationMSec,
+				   uint8_t inVolume,const T2K_ToneModulation *inModulation);
 
 void t2kQuiet();
 
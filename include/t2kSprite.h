@@ -20,23 +20,37 @@
 enum SpriteType {
 	kST_Invalid =0,
 	kST_16colors=1,
+	kST_16colors_Packed=2,		// 4 bits per pixel (see t2kInitPackedSprite)
+	kST_256colors=3,			// RGB332 per pixel (see t2kInit256colorSprite)
+};
+
+// flags for t2kPutSpriteEx (can be combined)
+enum SpriteFlag {
+	kSF_FlipH=1,		// mirror left and right
+	kSF_FlipV=2,		// mirror top and bottom
+	kSF_Rot90=4,		// rotate 90 degrees clockwise (applied before the flips)
 };
 
 struct T2K_SpriteInfo {
 	uint8_t spriteType;
 	uint8_t width,height;
-	uint8_t numOfFrames;		// 1 means still image.
+	uint8_t numOfFrames;		// 1 means still image. (see t2kInitSpriteSheet)
 	int8_t centerX,centerY;		// offset of lfet and top in bitmap.
-	int8_t numOfColors;			// 16 or 256
+	int16_t numOfColors;		// 16 or 256
 	int16_t transparentColor;	// -1 is no transparent color
 	bool bitmap_needToFree;		// true if bitmap is created by malloc.
 	bool palette_needToFree;	// true if palette is created by malloc.
+	bool spans_needToFree;		// true if spans are created by malloc.
+	bool mask_needToFree;		// true if mask is created by malloc.
+	bool isOpaque;				// true if no transparent pixels.
 };
 
 struct T2K_Sprite16colors {
 	T2K_SpriteInfo spriteInfo;	// piggy back
-	uint8_t *bitmap;
+	const uint8_t *bitmap;		// may be in flash (see t2kInitSpriteFromROM)
 	uint8_t *palette;
+	const uint8_t *spans;		// made by t2kCompileSprite (NULL means not compiled).
+	const uint32_t *mask;		// collision mask (see t2kCollision.h)
 };
 
 // pattern str info
@@ -75,8 +89,89 @@ bool t2kInitSprite(T2K_Sprite16colors *outSprite,int inWidth,int inHeight,
 				   int8_t inOriginX=0,int8_t inOriginY=0,
 				   bool inUsePalette=false,uint8_t *inPaletteArea=NULL,
 				   uint8_t *inBitmapArea=NULL);
+bool t2kInitPackedSprite(T2K_Sprite16colors *outSprite,int inWidth,int inHeight,
+						 const char *inPatternStrArray[],
+						 int8_t inOriginX=0,int8_t inOriginY=0,
+						 bool inUsePalette=false,uint8_t *inPaletteArea=NULL,
+						 uint8_t *inBitmapArea=NULL);
+bool t2kInitSpriteSheet(T2K_Sprite16colors *outSprite,
+						int inWidth,int inHeight,int inNumOfFrames,
+						const char *inPatternStrArray[],
+						int8_t inOriginX=0,int8_t inOriginY=0,
+						bool inUsePalette=false,uint8_t *inPaletteArea=NULL,
+						uint8_t *inBitmapArea=NULL,bool inIsPacked=false);
+// the 256 colors sprite has RGB332 colors in the bitmap and no palette.
+// inTransparentColor is the color key (-1 means no transparent color).
+// a custom palette for it (inCustomPalette of t2kPutSprite etc.) maps every
+// RGB332 color, so it must have 256 entries (not 16).
+bool t2kInit256colorSprite(T2K_Sprite16colors *outSprite,int inWidth,int inHeight,
+						   const uint8_t *inPixels,
+						   int8_t inOriginX=0,int8_t inOriginY=0,
+						   int16_t inTransparentColor=-1,uint8_t *inBitmapArea=NULL);
+
+// sprite data in flash, made by tools/t2kSpriteConv.cpp.
+// t2kInitSpriteFromROM refers to the arrays without copying or parsing.
+struct T2K_SpriteROM {
+	uint8_t spriteType;			// kST_16colors, kST_16colors_Packed or kST_256colors
+	uint8_t width,height;		// of a frame
+	uint8_t numOfFrames;
+	int8_t centerX,centerY;
+	int16_t transparentColor;	// -1 is no transparent color
+	bool isOpaque;
+	const uint8_t *bitmap;
+	const uint8_t *palette;		// NULL means the default palette (ignored for 256 colors)
+	const uint8_t *spans;		// NULL means not compiled (see t2kCompileSprite)
+	const uint32_t *mask;		// NULL means no pixel perfect collision
+};
+bool t2kInitSpriteFromROM(T2K_Sprite16colors *outSprite,const T2K_SpriteROM *inROM);
+void t2kFreeSprite(T2K_Sprite16colors *ioSprite);
+
+// sprite arena: if it is set up, the bitmaps, palettes, spans and masks made by
+// t2kInitSprite etc. are taken from it instead of malloc (4 bytes aligned).
+// the sprites made after t2kSpriteArenaMark are freed at once by
+// t2kSpriteArenaRelease, for example when a scene ends:
+//	uint32_t mark=t2kSpriteArenaMark();
+//	t2kInitSprite(&gEnemy,...);
+//	...
+//	t2kSpriteArenaRelease(mark);
+bool t2kSpriteArenaInit(uint32_t inSize,uint8_t *inArea=NULL);
+uint32_t t2kSpriteArenaMark();
+void t2kSpriteArenaRelease(uint32_t inMark=0);
+uint32_t t2kSpriteArenaUsed();
+uint32_t t2kSpriteArenaHighWaterMark();	// max of used bytes (to tune the size)
+bool t2kCompileSprite(T2K_Sprite16colors *ioSprite);
+// the collision mask for t2kHitTest (not made by t2kInitSprite etc.).
+bool t2kBuildCollisionMask(T2K_Sprite16colors *ioSprite);
 bool t2kPutSprite(T2K_Sprite16colors *inSprite,int inX,int inY,
 				  uint8_t *inCustomPalette=NULL);
+bool t2kPutSpriteFrame(T2K_Sprite16colors *inSprite,int inFrame,int inX,int inY,
+					   uint8_t *inCustomPalette=NULL);
+bool t2kPutSpriteEx(T2K_Sprite16colors *inSprite,int inX,int inY,uint8_t inFlags,
+					uint8_t *inCustomPalette=NULL,int inFrame=0);
+bool t2kPutSpriteAffine(T2K_Sprite16colors *inSprite,int inX,int inY,
+						float inAngle,float inScale=1.0f,
+						uint8_t *inCustomPalette=NULL,int inFrame=0);
+
+// animation of a sprite sheet. many animators can share a sprite.
+struct T2K_SpriteAnimator {
+	T2K_Sprite16colors *sprite;
+	uint16_t frameMSec;			// duration of a frame (0 means no animation)
+	uint16_t elapsedMSec;		// in the current frame
+	uint8_t frame;
+	bool isLoop;
+	bool isFinished;			// true if not loop and reached the last frame.
+};
+void t2kInitSpriteAnimator(T2K_SpriteAnimator *outAnimator,T2K_Sprite16colors *inSprite,
+						   uint16_t inFrameMSec,bool inIsLoop=true);
+void t2kUpdateSpriteAnimator(T2K_SpriteAnimator *ioAnimator,uint32_t inElapsedMSec);
+bool t2kPutSpriteAnimator(const T2K_SpriteAnimator *inAnimator,int inX,int inY,
+						  uint8_t *inCustomPalette=NULL);
+
+// sprite list (draw sprites sorted by z at once)
+bool t2kSpriteListAdd(T2K_Sprite16colors *inSprite,int inX,int inY,uint8_t inZ=0,
+					  uint8_t *inCustomPalette=NULL,uint8_t inFrame=0);
+int t2kSpriteListFlush();	// return num of drawn sprites
+void t2kSpriteListClear();
 
 void t2kSetDefault16colorPalette(uint8_t *outPalette);
 
@@ -0,0 +1,238 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+#ifndef __T2K_SPRITE_PATTERN_H__
+#define __T2K_SPRITE_PATTERN_H__
+
+#include <t2kSprite.h>
+
+// compile the pattern str (see t2kSprite.h) at compile time.
+// T2K_ASCII_SPRITE makes a T2K_SpriteROM with the packed bitmap, the spans
+// (same as t2kCompileSprite) and the collision mask in flash, so the sprite
+// needs no parsing and no RAM for the bitmap. an invalid color command is
+// a compile error (a call to t2kSpritePattern_InvalidColorCommand).
+// use it at namespace scope:
+//
+//	T2K_ASCII_SPRITE(gAlienROM,8,8,1,0,0,
+//		"__GGGGg_"
+//		"_GggggGg"
+//		...
+//	);
+//	static T2K_Sprite16colors gAlienSprite;
+//	t2kInitSpriteFromROM(&gAlienSprite,&gAlienROM);	// no copy
+//
+// rows are concatenated into a str. frames are stacked vertically as
+// t2kInitSpriteSheet. '_' (index color 0) is the transparent color.
+#define T2K_ASCII_SPRITE(inName,inWidth,inHeight,inNumOfFrames,inOriginX,inOriginY,inPattern) \
+	constexpr char inName##_pattern[]=inPattern; \
+	static_assert(sizeof(inName##_pattern)==(inWidth)*(inHeight)*(inNumOfFrames)+1, \
+				  #inName ": the pattern should have width*height*numOfFrames color commands."); \
+	constexpr T2K_SpriteROM inName={ \
+		kST_16colors_Packed,(inWidth),(inHeight),(inNumOfFrames),(inOriginX),(inOriginY),0, \
+		t2kSpritePattern_IsOpaque(inName##_pattern,0,(inWidth)*(inHeight)*(inNumOfFrames)), \
+		T2K_SpritePatternData<inName##_pattern,(inWidth),(inHeight)*(inNumOfFrames)>::Bitmap::data, \
+		NULL, \
+		T2K_SpritePatternData<inName##_pattern,(inWidth),(inHeight)*(inNumOfFrames)>::Spans::data, \
+		T2K_SpritePatternData<inName##_pattern,(inWidth),(inHeight)*(inNumOfFrames)>::Mask::data, \
+	}
+
+// ============================== implementation ==============================
+// C++11 constexpr functions have a single return statement, so the loops are
+// written as recursions. the recursions along a row are at most the width
+// deep, and the ones over the pixels or the rows are binary (log deep),
+// so the num of rows is limited only by the 64KB spans.
+
+// not constexpr, so calling this in a constant expression is a compile error.
+inline uint8_t t2kSpritePattern_InvalidColorCommand() { return 0; }
+
+constexpr uint8_t t2kSpritePattern_ColorIndex(char inColorCommand) {
+	return inColorCommand=='_' ?  0 : inColorCommand=='b' ?  1 :
+		   inColorCommand=='r' ?  2 : inColorCommand=='m' ?  3 :
+		   inColorCommand=='g' ?  4 : inColorCommand=='c' ?  5 :
+		   inColorCommand=='y' ?  6 : inColorCommand=='w' ?  7 :
+		   inColorCommand=='k' ?  8 : inColorCommand=='B' ?  9 :
+		   inColorCommand=='R' ? 10 : inColorCommand=='M' ? 11 :
+		   inColorCommand=='G' ? 12 : inColorCommand=='C' ? 13 :
+		   inColorCommand=='Y' ? 14 : inColorCommand=='W' ? 15 :
+		   t2kSpritePattern_InvalidColorCommand();
+}
+// binary recursion, because a pattern can have more pixels than the depth limit.
+constexpr bool t2kSpritePattern_IsOpaque(const char *inPattern,int inBegin,int inEnd) {
+	return inEnd-inBegin==1 ? inPattern[inBegin]!='_'
+		   : t2kSpritePattern_IsOpaque(inPattern,inBegin,(inBegin+inEnd)/2)
+			 && t2kSpritePattern_IsOpaque(inPattern,(inBegin+inEnd)/2,inEnd);
+}
+
+// ---------- packed bitmap (see t2kInitPackedSprite) ----------
+constexpr uint8_t t2kSpritePattern_PackedPair(const char *inRow,int inWidth,int inU) {
+	return (uint8_t)((t2kSpritePattern_ColorIndex(inRow[inU])<<4)
+					 | (inU+1<inWidth ? t2kSpritePattern_ColorIndex(inRow[inU+1]) : 0));
+}
+constexpr uint8_t t2kSpritePattern_PackedByte(const char *inPattern,int inWidth,int inIndex) {
+	return t2kSpritePattern_PackedPair(inPattern+inIndex/((inWidth+1)/2)*inWidth,inWidth,
+									   inIndex%((inWidth+1)/2)*2);
+}
+
+// ---------- collision mask (see t2kCollision.h) ----------
+constexpr uint32_t t2kSpritePattern_MaskBits(const char *inRow,int inU,int inEnd) {
+	return inU>=inEnd ? 0
+		   : (inRow[inU]!='_' ? 0x80000000u>>(inU & 31) : 0)
+			 | t2kSpritePattern_MaskBits(inRow,inU+1,inEnd);
+}
+constexpr uint32_t t2kSpritePattern_MaskWord(const char *inPattern,int inWidth,int inIndex) {
+	return t2kSpritePattern_MaskBits(inPattern+inIndex/((inWidth+31)/32)*inWidth,
+									 inIndex%((inWidth+31)/32)*32,
+									 inIndex%((inWidth+31)/32)*32+32<inWidth
+									 ? inIndex%((inWidth+31)/32)*32+32 : inWidth);
+}
+
+// ---------- spans (see t2kCompileSprite) ----------
+constexpr bool t2kSpritePattern_IsSpanStart(const char *inRow,int inU) {
+	return inRow[inU]!='_' && (inU==0 || inRow[inU-1]=='_');
+}
+constexpr int t2kSpritePattern_RunLength(const char *inRow,int inWidth,int inU) {
+	return inU<inWidth && inRow[inU]!='_'
+		   ? 1+t2kSpritePattern_RunLength(inRow,inWidth,inU+1) : 0;
+}
+constexpr int t2kSpritePattern_NumOfSpans(const char *inRow,int inWidth,int inU) {
+	return inU>=inWidth ? 0
+		   : (t2kSpritePattern_IsSpanStart(inRow,inU) ? 1 : 0)
+			 +t2kSpritePattern_NumOfSpans(inRow,inWidth,inU+1);
+}
+// bytes of a row including numOfSpans.
+constexpr int t2kSpritePattern_RowSize(const char *inRow,int inWidth,int inU) {
+	return inU>=inWidth ? 1
+		   : (inRow[inU]=='_' ? 0 : t2kSpritePattern_IsSpanStart(inRow,inU) ? 3 : 1)
+			 +t2kSpritePattern_RowSize(inRow,inWidth,inU+1);
+}
+constexpr uint8_t t2kSpritePattern_SpanPixel(const char *inRow,int inWidth,int inIndex,int inU);
+// inIndex-th byte of the spans after numOfSpans, looking for the span from inU.
+constexpr uint8_t t2kSpritePattern_SpanByte(const char *inRow,int inWidth,int inIndex,
+											int inU,int inPrevEnd) {
+	return inRow[inU]=='_'
+		   ? t2kSpritePattern_SpanByte(inRow,inWidth,inIndex,inU+1,inPrevEnd)
+		   : inIndex==0 ? (uint8_t)(inU-inPrevEnd)		// skip
+		   : inIndex==1 ? (uint8_t)t2kSpritePattern_RunLength(inRow,inWidth,inU)
+		   : t2kSpritePattern_SpanPixel(inRow,inWidth,inIndex-2,inU);
+}
+// inIndex-th index color in the span, from the pixel inU.
+constexpr uint8_t t2kSpritePattern_SpanPixel(const char *inRow,int inWidth,int inIndex,int inU) {
+	return inIndex==0 ? t2kSpritePattern_ColorIndex(inRow[inU])
+		   : inU+1<inWidth && inRow[inU+1]!='_'
+			 ? t2kSpritePattern_SpanPixel(inRow,inWidth,inIndex-1,inU+1)
+			 : t2kSpritePattern_SpanByte(inRow,inWidth,inIndex-1,inU+1,inU+1);
+}
+constexpr uint8_t t2kSpritePattern_RowByte(const char *inRow,int inWidth,int inIndex) {
+	return inIndex==0 ? (uint8_t)t2kSpritePattern_NumOfSpans(inRow,inWidth,0)
+		   : t2kSpritePattern_SpanByte(inRow,inWidth,inIndex-1,0,0);
+}
+
+// ---------- arrays ----------
+// T2K_SpritePatternSeq<0,1,...,N-1> (the depth of instantiation is log N).
+template<int... I> struct T2K_SpritePatternSeq { typedef T2K_SpritePatternSeq type; };
+template<class A,class B> struct T2K_SpritePatternConcat;
+template<int... I,int... J>
+struct T2K_SpritePatternConcat<T2K_SpritePatternSeq<I...>,T2K_SpritePatternSeq<J...>>
+	: T2K_SpritePatternSeq<I...,(int)sizeof...(I)+J...> {};
+template<int N> struct T2K_SpritePatternMakeSeq
+	: T2K_SpritePatternConcat<typename T2K_SpritePatternMakeSeq<N/2>::type,
+							  typename T2K_SpritePatternMakeSeq<N-N/2>::type> {};
+template<> struct T2K_SpritePatternMakeSeq<0> : T2K_SpritePatternSeq<> {};
+template<> struct T2K_SpritePatternMakeSeq<1> : T2K_SpritePatternSeq<0> {};
+
+template<const char *P,int W,class S> struct T2K_SpritePatternBitmap;
+template<const char *P,int W,int... I> struct T2K_SpritePatternBitmap<P,W,T2K_SpritePatternSeq<I...>> {
+	static constexpr uint8_t data[sizeof...(I)]={ t2kSpritePattern_PackedByte(P,W,I)... };
+};
+template<const char *P,int W,int... I>
+constexpr uint8_t T2K_SpritePatternBitmap<P,W,T2K_SpritePatternSeq<I...>>::data[sizeof...(I)];
+
+// the spans are made a row at a time, and the rows [B,E) are concatenated by
+// halves, so each row is made once and the depth is log R. Offsets are the
+// offsets of the rows from the first row.
+template<uint8_t... B> struct T2K_SpritePatternBytes { typedef T2K_SpritePatternBytes type; };
+template<class A,class B> struct T2K_SpritePatternBytesConcat;
+template<uint8_t... A,uint8_t... B>
+struct T2K_SpritePatternBytesConcat<T2K_SpritePatternBytes<A...>,T2K_SpritePatternBytes<B...>>
+	: T2K_SpritePatternBytes<A...,B...> {};
+template<class A,class B,int K> struct T2K_SpritePatternOffsetsConcat;
+template<int... I,int... J,int K>
+struct T2K_SpritePatternOffsetsConcat<T2K_SpritePatternSeq<I...>,T2K_SpritePatternSeq<J...>,K>
+	: T2K_SpritePatternSeq<I...,(J+K)...> {};
+
+template<const char *P,int W,int Row,class S> struct T2K_SpritePatternRowBytes;
+template<const char *P,int W,int Row,int... I>
+struct T2K_SpritePatternRowBytes<P,W,Row,T2K_SpritePatternSeq<I...>>
+	: T2K_SpritePatternBytes<t2kSpritePattern_RowByte(P+Row*W,W,I)...> {};
+
+template<const char *P,int W,int B,int E,bool IsSingleRow=(E-B==1)> struct T2K_SpritePatternRows {
+	typedef T2K_SpritePatternRows<P,W,B,(B+E)/2> Head;
+	typedef T2K_SpritePatternRows<P,W,(B+E)/2,E> Tail;
+	static const int size=Head::size+Tail::size;
+	typedef typename T2K_SpritePatternBytesConcat<typename Head::Body,
+												  typename Tail::Body>::type Body;
+	typedef typename T2K_SpritePatternOffsetsConcat<typename Head::Offsets,
+													typename Tail::Offsets,Head::size>::type Offsets;
+};
+template<const char *P,int W,int B,int E> struct T2K_SpritePatternRows<P,W,B,E,true> {
+	static const int size=t2kSpritePattern_RowSize(P+B*W,W,0);
+	typedef typename T2K_SpritePatternRowBytes<P,W,B,
+				typename T2K_SpritePatternMakeSeq<size>::type>::type Body;
+	typedef T2K_SpritePatternSeq<0> Offsets;
+};
+
+template<class O> struct T2K_SpritePatternOffsetTable;
+template<int... O> struct T2K_SpritePatternOffsetTable<T2K_SpritePatternSeq<O...>> {
+	static constexpr int value[sizeof...(O)]={ O... };
+};
+template<int... O>
+constexpr int T2K_SpritePatternOffsetTable<T2K_SpritePatternSeq<O...>>::value[sizeof...(O)];
+
+// rowOffset[] (I) is stored in little endian as the CPU reads it, and the rows (B) follow.
+template<int R,class S,class O,class B> struct T2K_SpritePatternSpans;
+template<int R,int... I,class O,uint8_t... B>
+struct T2K_SpritePatternSpans<R,T2K_SpritePatternSeq<I...>,O,T2K_SpritePatternBytes<B...>> {
+	alignas(4) static constexpr uint8_t data[sizeof...(I)+sizeof...(B)]={
+		(uint8_t)(((int)sizeof(uint16_t)*R+T2K_SpritePatternOffsetTable<O>::value[I/2])
+				  >>((I & 1)*8))...,
+		B...
+	};
+};
+template<int R,int... I,class O,uint8_t... B>
+alignas(4) constexpr uint8_t
+T2K_SpritePatternSpans<R,T2K_SpritePatternSeq<I...>,O,T2K_SpritePatternBytes<B...>>
+	::data[sizeof...(I)+sizeof...(B)];
+
+template<const char *P,int W,class S> struct T2K_SpritePatternMask;
+template<const char *P,int W,int... I> struct T2K_SpritePatternMask<P,W,T2K_SpritePatternSeq<I...>> {
+	static constexpr uint32_t data[sizeof...(I)]={ t2kSpritePattern_MaskWord(P,W,I)... };
+};
+template<const char *P,int W,int... I>
+constexpr uint32_t T2K_SpritePatternMask<P,W,T2K_SpritePatternSeq<I...>>::data[sizeof...(I)];
+
+// R is the num of rows of all frames.
+template<const char *P,int W,int R> struct T2K_SpritePatternData {
+	static_assert(0<W && W<256 && 0<R,"invalid size of the sprite pattern.");
+	typedef T2K_SpritePatternRows<P,W,0,R> Rows;
+	static_assert((int)sizeof(uint16_t)*R+Rows::size<=UINT16_MAX,"too large sprite pattern.");
+	typedef T2K_SpritePatternBitmap<P,W,
+				typename T2K_SpritePatternMakeSeq<(W+1)/2*R>::type> Bitmap;
+	typedef T2K_SpritePatternSpans<R,
+				typename T2K_SpritePatternMakeSeq<(int)sizeof(uint16_t)*R>::type,
+				typename Rows::Offsets,typename Rows::Body> Spans;
+	typedef T2K_SpritePatternMask<P,W,
+				typename T2K_SpritePatternMakeSeq<(W+31)/32*R>::type> Mask;
+};
+
+#endif
@@ -0,0 +1,98 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+#ifndef __T2K_TILEMAP_H__
+#define __T2K_TILEMAP_H__
+
+#include <t2kSprite.h>
+
+// the tile set is a sprite sheet of 8x8 or 16x16 frames (any sprite type),
+// a frame is a tile. the map is mapWidth*mapHeight tile numbers (row major).
+// for parallax, put the layers from the back with their own scroll, e.g.
+//	t2kSetTilemapScroll(&gFar, gCameraX/4,0);
+//	t2kSetTilemapScroll(&gNear,gCameraX,  0);
+//	t2kPutTilemap(&gFar);
+//	t2kPutTilemap(&gNear);		// transparent pixels show gFar.
+enum TileAttr {
+	kTA_Empty =0,		// all pixels are transparent (skipped)
+	kTA_Opaque=1,		// no transparent pixels (copied)
+	kTA_Mixed =2,
+};
+
+struct T2K_Tilemap {
+	const T2K_Sprite16colors *tileSet;
+	const uint8_t *map;			// may be in flash
+	uint16_t mapWidth,mapHeight;	// in tiles
+	uint8_t tileSize;			// 8 or 16
+	bool isLoop;				// true: the map wraps around, false: out of the map is not drawn.
+	int scrollX,scrollY;		// the position in the map shown at the left top of GRAM
+	uint8_t tileAttr[256];		// TileAttr of each tile (made by t2kInitTilemap)
+	const uint8_t *collisionAttr;	// TileCollision of each tile (NULL means no collision)
+	int numOfCollisionAttrs;
+};
+
+bool t2kInitTilemap(T2K_Tilemap *outTilemap,const T2K_Sprite16colors *inTileSet,
+					const uint8_t *inMap,int inMapWidth,int inMapHeight,bool inIsLoop=true);
+void t2kSetTilemapScroll(T2K_Tilemap *ioTilemap,int inScrollX,int inScrollY);
+// draw the rows [inTop,inBottom) of GRAM (the default is the whole screen).
+bool t2kPutTilemap(const T2K_Tilemap *inTilemap,uint8_t *inCustomPalette=NULL,
+				   int inTop=0,int inBottom=kGRamHeight);
+
+// collision: the queries use the map coordinates (GRAM x + scrollX) and read
+// only the tiles they touch. the tiles out of the map (not loop) are kTC_None.
+enum TileCollision {
+	kTC_None=0,
+	kTC_Solid=1,
+	kTC_SlopeUp=2,		// '/' the floor rises to the right
+	kTC_SlopeDown=3,	// '\' the floor falls to the right
+};
+// flags of t2kTilemapMoveBox
+enum TileHitFlag {
+	kTH_Left=1,
+	kTH_Right=2,
+	kTH_Top=4,
+	kTH_Bottom=8,		// on the floor (solid or slope)
+};
+struct T2K_TileHit {
+	int tileX,tileY;			// in tiles
+	uint8_t tileNo;
+	uint8_t collision;			// TileCollision
+};
+struct T2K_TileRayHit {
+	T2K_TileHit tile;
+	float x,y;					// the hit point
+	float t;					// in [0,1] along the ray
+	int8_t normalX,normalY;		// (0,0) if the ray starts in the tile
+};
+
+// inCollisionAttr[tileNo] is a TileCollision (tileNo>=inNumOfAttrs is kTC_None).
+void t2kSetTilemapCollision(T2K_Tilemap *ioTilemap,const uint8_t *inCollisionAttr,
+							int inNumOfAttrs);
+int t2kGetTileCollision(const T2K_Tilemap *inTilemap,int inTileX,int inTileY);
+// the tiles (not kTC_None) in [inLeft,inRight)x[inTop,inBottom). return the num
+// of the tiles (outHits has at most inMaxHits of them, outHits may be NULL).
+int t2kTilemapQueryBox(const T2K_Tilemap *inTilemap,int inLeft,int inTop,int inRight,int inBottom,
+					   T2K_TileHit *outHits=NULL,int inMaxHits=0);
+// the first tile (not kTC_None) on the segment (inX0,inY0)-(inX1,inY1) by DDA.
+bool t2kTilemapRaycast(const T2K_Tilemap *inTilemap,float inX0,float inY0,float inX1,float inY1,
+					   T2K_TileRayHit *outHit);
+// the y of the floor surface at inX in the tile including (inX,inY).
+bool t2kTilemapGetFloorY(const T2K_Tilemap *inTilemap,int inX,int inY,int *outFloorY);
+// move the box (ioLeft,ioTop,inWidth,inHeight) by (inDX,inDY), x first then y.
+// solid tiles block the box and slopes lift it to the floor. return TileHitFlags.
+uint8_t t2kTilemapMoveBox(const T2K_Tilemap *inTilemap,int *ioLeft,int *ioTop,
+						  int inWidth,int inHeight,int inDX,int inDY);
+
+#endif
+
@@ -0,0 +1,223 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft 
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+#include "t2kCommon.h"
+
+#include "t2kSprite.h"
+#include "t2kCollision.h"
+
+const int kCollisionCellShift=4;	// 16x16 pixels
+const int kCollisionGridWidth =(kGRamWidth +(1<<kCollisionCellShift)-1)>>kCollisionCellShift;
+const int kCollisionGridHeight=(kGRamHeight+(1<<kCollisionCellShift)-1)>>kCollisionCellShift;
+const int kNumOfCollisionCells=kCollisionGridWidth*kCollisionGridHeight;
+const int kCollisionCellsPerObject=4;	// average (a 16x16 object is in 4 cells at most)
+
+struct CollisionObject {
+	int16_t left,top,right,bottom;	// [left,right)x[top,bottom)
+	uint8_t category;
+	uint8_t mask;
+	uint8_t cellLeft,cellTop,cellRight,cellBottom;	// inclusive
+};
+
+static CollisionObject *gCollisionObject=NULL;
+static uint16_t *gCollisionCellEntry=NULL;		// object ids sorted by cell
+static int gMaxCollisionObjects=0;
+static int gMaxCollisionCellEntries=0;
+static int gNumOfCollisionObjects=0;
+static int gNumOfCollisionCellEntries=0;
+static uint16_t gCollisionCellStart[kNumOfCollisionCells+1];
+
+static uint32_t getMaskBits(const uint32_t *inMaskRow,int inWordsPerRow,int inU);
+static int toCellX(int inX);
+static int toCellY(int inY);
+
+bool t2kHitTest(const T2K_Sprite16colors *inSpriteA,int inXA,int inYA,
+				const T2K_Sprite16colors *inSpriteB,int inXB,int inYB) {
+	return t2kHitTestFrame(inSpriteA,0,inXA,inYA,inSpriteB,0,inXB,inYB);
+}
+
+// 1. reject by the bounding boxes.
+// 2. AND the masks in the intersection, 32 pixels at a time.
+bool t2kHitTestFrame(const T2K_Sprite16colors *inSpriteA,int inFrameA,int inXA,int inYA,
+					 const T2K_Sprite16colors *inSpriteB,int inFrameB,int inXB,int inYB) {
+	const T2K_SpriteInfo *a=&inSpriteA->spriteInfo;
+	const T2K_SpriteInfo *b=&inSpriteB->spriteInfo;
+	if(inFrameA<0 || a->numOfFrames<=inFrameA
+	   || inFrameB<0 || b->numOfFrames<=inFrameB) {
+		return false;
+	}
+
+	// areas are [left,right)x[top,bottom)
+	const int leftA=inXA-a->centerX, topA=inYA-a->centerY;
+	const int leftB=inXB-b->centerX, topB=inYB-b->centerY;
+	const int left  =max(leftA,leftB);
+	const int right =min(leftA+a->width,leftB+b->width);
+	const int top   =max(topA,topB);
+	const int bottom=min(topA+a->height,topB+b->height);
+	if(left>=right || top>=bottom) { return false; }
+	if(inSpriteA->mask==NULL || inSpriteB->mask==NULL) { return true; }
+
+	const int wordsPerRowA=(a->width+31)/32;
+	const int wordsPerRowB=(b->width+31)/32;
+	const uint32_t *rowA=inSpriteA->mask+(inFrameA*a->height+top-topA)*wordsPerRowA;
+	const uint32_t *rowB=inSpriteB->mask+(inFrameB*b->height+top-topB)*wordsPerRowB;
+	for(int y=top; y<bottom; y++,rowA+=wordsPerRowA,rowB+=wordsPerRowB) {
+		for(int x=left; x<right; x+=32) {
+			uint32_t bits=getMaskBits(rowA,wordsPerRowA,x-leftA)
+						 & getMaskBits(rowB,wordsPerRowB,x-leftB);
+			if(right-x<32) { bits&=~(0xFFFFFFFFu>>(right-x)); }
+			if(bits!=0) { return true; }
+		}
+	}
+	return false;
+}
+
+// 32 pixels from inU (MSB is inU).
+static uint32_t getMaskBits(const uint32_t *inMaskRow,int inWordsPerRow,int inU) {
+	const int index=inU>>5;
+	const int shift=inU & 31;
+	uint32_t bits=inMaskRow[index]<<shift;
+	if(shift!=0 && index+1<inWordsPerRow) {
+		bits|=inMaskRow[index+1]>>(32-shift);
+	}
+	return bits;
+}
+
+// ============================== broad phase ==============================
+// all buffers are allocated here (not for each frame).
+bool t2kCollisionGridInit(int inMaxObjects) {
+	if(inMaxObjects<=0 || UINT16_MAX<inMaxObjects) { return false; }
+	free(gCollisionObject);
+	free(gCollisionCellEntry);
+	gMaxCollisionObjects=inMaxObjects;
+	gMaxCollisionCellEntries=inMaxObjects*kCollisionCellsPerObject;
+	if(gMaxCollisionCellEntries>UINT16_MAX) { gMaxCollisionCellEntries=UINT16_MAX; }
+	gCollisionObject=(CollisionObject *)malloc(sizeof(CollisionObject)*gMaxCollisionObjects);
+	gCollisionCellEntry=(uint16_t *)malloc(sizeof(uint16_t)*gMaxCollisionCellEntries);
+	if(gCollisionObject==NULL || gCollisionCellEntry==NULL) {
+		ERROR("ERROR t2kCollisionGridInit: not enough memory.\n");
+		free(gCollisionObject);
+		free(gCollisionCellEntry);
+		gCollisionObject=NULL;
+		gCollisionCellEntry=NULL;
+		gMaxCollisionObjects=0;
+		return false;
+	}
+	t2kCollisionGridClear();
+	return true;
+}
+
+void t2kCollisionGridClear() {
+	gNumOfCollisionObjects=0;
+	gNumOfCollisionCellEntries=0;
+}
+
+int t2kCollisionGridAdd(int inLeft,int inTop,int inRight,int inBottom,
+						uint8_t inCategory,uint8_t inMask) {
+	if(inLeft>=inRight || inTop>=inBottom) { return -1; }
+	if(gNumOfCollisionObjects>=gMaxCollisionObjects) {
+		ERROR("ERROR t2kCollisionGridAdd: too many objects (max=%d).\n",gMaxCollisionObjects);
+		return -1;
+	}
+	CollisionObject *object=gCollisionObject+gNumOfCollisionObjects;
+	object->left=inLeft;
+	object->top=inTop;
+	object->right=inRight;
+	object->bottom=inBottom;
+	object->category=inCategory;
+	object->mask=inMask;
+	object->cellLeft  =toCellX(inLeft);
+	object->cellTop   =toCellY(inTop);
+	object->cellRight =toCellX(inRight-1);
+	object->cellBottom=toCellY(inBottom-1);
+	int numOfCells=(object->cellRight-object->cellLeft+1)*(object->cellBottom-object->cellTop+1);
+	if(gNumOfCollisionCellEntries+numOfCells>gMaxCollisionCellEntries) {
+		ERROR("ERROR t2kCollisionGridAdd: too many cell entries (max=%d).\n",
+			  gMaxCollisionCellEntries);
+		return -1;
+	}
+	gNumOfCollisionCellEntries+=numOfCells;
+	return gNumOfCollisionObjects++;
+}
+
+int t2kCollisionGridAddSprite(const T2K_Sprite16colors *inSprite,int inX,int inY,
+							  uint8_t inCategory,uint8_t inMask) {
+	const T2K_SpriteInfo *info=&inSprite->spriteInfo;
+	int left=inX-info->centerX;
+	int top =inY-info->centerY;
+	return t2kCollisionGridAdd(left,top,left+info->width,top+info->height,
+							   inCategory,inMask);
+}
+
+// bucket the objects by cell (counting sort, O(n)), and test the pairs in
+// each cell. a pair in some cells is reported only in the cell that has
+// the top-left corner of the overlapped area.
+// return the num of reported pairs.
+int t2kCollisionGridFindPairs(T2K_CollisionPairCallback inCallback,void *ioContext) {
+	const int n=gNumOfCollisionObjects;
+	uint16_t *cellStart=gCollisionCellStart;
+	memset(cellStart,0,sizeof(gCollisionCellStart));
+	for(int i=0; i<n; i++) {
+		const CollisionObject *object=gCollisionObject+i;
+		for(int cy=object->cellTop; cy<=object->cellBottom; cy++) {
+			for(int cx=object->cellLeft; cx<=object->cellRight; cx++) {
+				cellStart[cy*kCollisionGridWidth+cx+1]++;
+			}
+		}
+	}
+	for(int c=0; c<kNumOfCollisionCells; c++) { cellStart[c+1]+=cellStart[c]; }
+	uint16_t fill[kNumOfCollisionCells];
+	memcpy(fill,cellStart,sizeof(fill));
+	for(int i=0; i<n; i++) {
+		const CollisionObject *object=gCollisionObject+i;
+		for(int cy=object->cellTop; cy<=object->cellBottom; cy++) {
+			for(int cx=object->cellLeft; cx<=object->cellRight; cx++) {
+				gCollisionCellEntry[fill[cy*kCollisionGridWidth+cx]++]=i;
+			}
+		}
+	}
+
+	int numOfPairs=0;
+	for(int c=0; c<kNumOfCollisionCells; c++) {
+		const int cx=c%kCollisionGridWidth;
+		const int cy=c/kCollisionGridWidth;
+		for(int i=cellStart[c]; i<cellStart[c+1]; i++) {
+			const int idA=gCollisionCellEntry[i];
+			const CollisionObject *a=gCollisionObject+idA;
+			for(int j=i+1; j<cellStart[c+1]; j++) {
+				const int idB=gCollisionCellEntry[j];
+				const CollisionObject *b=gCollisionObject+idB;
+				if((a->category & b->mask)==0 && (b->category & a->mask)==0) { continue; }
+				const int left=max(a->left,b->left);
+				const int top =max(a->top, b->top);
+				if(left>=min(a->right,b->right) || top>=min(a->bottom,b->bottom)) { continue; }
+				if(toCellX(left)!=cx || toCellY(top)!=cy) { continue; }	// reported in other cell
+				inCallback(idA,idB,ioContext);
+				numOfPairs++;
+			}
+		}
+	}
+	return numOfPairs;
+}
+
+static int toCellX(int inX) {
+	if(inX<0) { return 0; }
+	if(inX>=kGRamWidth) { return kCollisionGridWidth-1; }
+	return inX>>kCollisionCellShift;
+}
+static int toCellY(int inY) {
+	if(inY<0) { return 0; }
+	if(inY>=kGRamHeight) { return kCollisionGridHeight-1; }
+	return inY>>kCollisionCellShift;
+}
@@ -24,69 +24,533 @@ static uint8_t gSquarePattern[8]={
 	0xFF,0x81,0x81,0x81, 0x81,0x81,0x81,0xFF
 };
 
+// gGlyphExpansion[dots] has 0xFF in the bytes of the set pixels
+// (the MSB of dots is the left pixel = the lowest address).
+static uint64_t gGlyphExpansion[256];
+static bool gGlyphExpansionIsReady=false;
+
+static const T2K_GlyphSet *gGlyphSet=NULL;
+// incremented by t2kFontInit and t2kSetGlyphSet, so the text layers
+// rendered with the old glyphs are rendered again.
+static uint8_t gGlyphGeneration=0;
+
+static void initGlyphExpansion();
+static void putPattern(int inX,int inY,uint8_t inRGB332,const uint8_t *inPattern);
+static const uint8_t *getGlyph(char inChar);
+static uint32_t decodeUTF8(const char **ioString);
+static const uint8_t *getGlyphOfCodepoint(uint32_t inCodepoint,uint8_t *outPattern);
+static void decompressGlyph(const uint8_t *inData,uint8_t *outPattern);
+static const T2K_PackedGlyph *getPackedGlyph(const T2K_PackedFont *inFont,char inChar);
+static uint32_t getBits(const uint8_t *inBitmap,int inBitPos,int inNumOfBits);
+static int formatNumber(char *outString,uint32_t inAbsValue,bool inIsNegative,
+						int inNumOfDecimals,int inWidth,char inPad);
+static int formatFixed(char *outString,int32_t inValue,int inFracBits,int inNumOfDecimals,
+					   int inWidth,char inPad);
+
 bool t2kFontInit(const Font *inFont) {
 	gFont=inFont;
+	gGlyphGeneration++;
+	initGlyphExpansion();
 	return true;
 }
 
 void t2kPutChar(int inX,int inY,uint8_t inRGB332,char inChar) {
-	int charIndex = inChar<' ' || 0x7F<inChar ? 0x7F-' ' : inChar-' ';
-	const uint8_t *pattern = gFont==NULL ? gSquarePattern : gFont[charIndex].pattern;
-	uint8_t *gram=t2kGetFramebuffer();
-	int ye=inY+8;
-	int xe=inX+8;
-	for(int y=inY,i=0; y<ye; y++,i++) {
-		if(y<0 || 120<=y) { continue; }
-		uint8_t mask=0x80;
-		uint8_t dots=pattern[i];
-		for(int x=inX; x<xe; x++,mask=mask>>1) {
-			if(x<0 || 160<=x) { continue; }
-			if((dots & mask)==0) { continue; }
-			gram[FBA(x,y)]=inRGB332;
-		}
-	}
+	putPattern(inX,inY,inRGB332,getGlyph(inChar));
 }
 
+// inString is UTF-8.
 void t2kPutStr(int inX,int inY,uint8_t inRGB322,const char *inString) {
 	int x=inX;
-	for(int i=0; inString[i]!='\0'; i++,x+=8) {
-		t2kPutChar(x,inY,inRGB322,inString[i]);
+	uint8_t pattern[8];
+	while(*inString!='\0') {
+		putPattern(x,inY,inRGB322,getGlyphOfCodepoint(decodeUTF8(&inString),pattern));
+		x+=8;
 	}
 }
 
-static char gPrintfBuffer[256];
+void t2kPutCodepoint(int inX,int inY,uint8_t inRGB332,uint32_t inCodepoint) {
+	uint8_t pattern[8];
+	putPattern(inX,inY,inRGB332,getGlyphOfCodepoint(inCodepoint,pattern));
+}
+
+int t2kGetStrLength(const char *inString) {
+	int len=0;
+	while(*inString!='\0') {
+		decodeUTF8(&inString);
+		len++;
+	}
+	return len;
+}
+
+const int kPrintfBufferSize=256;
 void t2kPrintf(int inX,int inY,uint8_t inRGB322,const char *inFormat,...) {
+	char buffer[kPrintfBufferSize];
 	va_list arg;
     va_start(arg,inFormat);
-    vsprintf(gPrintfBuffer,inFormat,arg);
+    vsnprintf(buffer,sizeof(buffer),inFormat,arg);
     va_end(arg);
-	t2kPutStr(inX,inY,inRGB322,gPrintfBuffer);
+	t2kPutStr(inX,inY,inRGB322,buffer);
 }
 
 void t2kPrintf(int inY,uint8_t inRGB322,const char *inFormat,...) {
+	char buffer[kPrintfBufferSize];
 	va_list arg;
     va_start(arg,inFormat);
-    vsprintf(gPrintfBuffer,inFormat,arg);
+    vsnprintf(buffer,sizeof(buffer),inFormat,arg);
     va_end(arg);
 
-	int len=strlen(gPrintfBuffer);
+	int len=t2kGetStrLength(buffer);
 	int x=(kGRamWidth-len*8)/2;
-	t2kPutStr(x,inY,inRGB322,gPrintfBuffer);
+	t2kPutStr(x,inY,inRGB322,buffer);
+}
+
+// ============================== numbers ==============================
+// the digits go to putPattern directly (no string and no printf parsing).
+const int kMaxNumberLength=24;
+
+void t2kPutInt(int inX,int inY,uint8_t inRGB332,int32_t inValue,int inWidth,char inPad) {
+	char digits[kMaxNumberLength];
+	const uint32_t absValue = inValue<0 ? 0-(uint32_t)inValue : inValue;
+	const int len=formatNumber(digits,absValue,inValue<0,0,inWidth,inPad);
+	for(int i=0; i<len; i++,inX+=8) {
+		putPattern(inX,inY,inRGB332,getGlyph(digits[i]));
+	}
+}
+
+void t2kPutFixed(int inX,int inY,uint8_t inRGB332,int32_t inValue,int inFracBits,
+				 int inNumOfDecimals,int inWidth,char inPad) {
+	char digits[kMaxNumberLength];
+	const int len=formatFixed(digits,inValue,inFracBits,inNumOfDecimals,inWidth,inPad);
+	for(int i=0; i<len; i++,inX+=8) {
+		putPattern(inX,inY,inRGB332,getGlyph(digits[i]));
+	}
+}
+
+// ============================== text builder ==============================
+void t2kTextInit(T2K_Text *outText,char *inBuffer,int inSize) {
+	outText->buffer=inBuffer;
+	outText->size = inSize<UINT16_MAX ? inSize : UINT16_MAX;
+	t2kTextClear(outText);
+}
+
+void t2kTextClear(T2K_Text *ioText) {
+	ioText->length=0;
+	if(ioText->size>0) { ioText->buffer[0]='\0'; }
+}
+
+void t2kTextAddChar(T2K_Text *ioText,char inChar) {
+	if(ioText->length+1>=ioText->size) { return; }
+	ioText->buffer[ioText->length++]=inChar;
+	ioText->buffer[ioText->length]='\0';
+}
+
+void t2kTextAddStr(T2K_Text *ioText,const char *inString) {
+	while(*inString!='\0' && ioText->length+1<ioText->size) {
+		ioText->buffer[ioText->length++]=*inString++;
+	}
+	if(ioText->size>0) { ioText->buffer[ioText->length]='\0'; }
+}
+
+void t2kTextAddInt(T2K_Text *ioText,int32_t inValue,int inWidth,char inPad) {
+	char digits[kMaxNumberLength+1];
+	const uint32_t absValue = inValue<0 ? 0-(uint32_t)inValue : inValue;
+	digits[formatNumber(digits,absValue,inValue<0,0,inWidth,inPad)]='\0';
+	t2kTextAddStr(ioText,digits);
+}
+
+void t2kTextAddHex(T2K_Text *ioText,uint32_t inValue,int inWidth,char inPad) {
+	char digits[kMaxNumberLength+1];
+	if(inWidth>kMaxNumberLength) { inWidth=kMaxNumberLength; }
+	int n=0;
+	do {
+		digits[kMaxNumberLength-1-n++]="0123456789ABCDEF"[inValue & 0x0F];
+		inValue>>=4;
+	} while(inValue!=0);
+	while(n<inWidth) { digits[kMaxNumberLength-1-n++]=inPad; }
+	digits[kMaxNumberLength]='\0';
+	t2kTextAddStr(ioText,digits+kMaxNumberLength-n);
+}
+
+void t2kTextAddFixed(T2K_Text *ioText,int32_t inValue,int inFracBits,int inNumOfDecimals,
+					 int inWidth,char inPad) {
+	char digits[kMaxNumberLength+1];
+	digits[formatFixed(digits,inValue,inFracBits,inNumOfDecimals,inWidth,inPad)]='\0';
+	t2kTextAddStr(ioText,digits);
+}
+
+void t2kTextPrintf(T2K_Text *ioText,const char *inFormat,...) {
+	if(ioText->length+1>=ioText->size) { return; }
+	va_list arg;
+	va_start(arg,inFormat);
+	int n=vsnprintf(ioText->buffer+ioText->length,ioText->size-ioText->length,inFormat,arg);
+	va_end(arg);
+	if(n<0) {
+		ioText->buffer[ioText->length]='\0';
+		return;
+	}
+	ioText->length = ioText->length+n<ioText->size ? ioText->length+n : ioText->size-1;
+}
+
+void t2kPutText(int inX,int inY,uint8_t inRGB332,const T2K_Text *inText) {
+	if(inText->length>0) { t2kPutStr(inX,inY,inRGB332,inText->buffer); }
 }
 
 void t2kDrawFontPattern(int inX,int inY,uint8_t inRGB332,const uint8_t *inPattern) {
+	putPattern(inX,inY,inRGB332,inPattern);
+}
+
+static const uint8_t *getGlyph(char inChar) {
+	int charIndex = inChar<' ' || 0x7F<inChar ? 0x7F-' ' : inChar-' ';
+	return gFont==NULL ? gSquarePattern : gFont[charIndex].pattern;
+}
+// write inAbsValue (right aligned to inWidth) to outString and return the
+// length. the last inNumOfDecimals digits are the fraction part.
+// the sign is put before '0' pads and after ' ' pads as printf.
+static int formatNumber(char *outString,uint32_t inAbsValue,bool inIsNegative,
+						int inNumOfDecimals,int inWidth,char inPad) {
+	char digits[kMaxNumberLength];
+	int n=0;
+	do {
+		digits[n++]='0'+inAbsValue%10;
+		inAbsValue/=10;
+		if(n==inNumOfDecimals) { digits[n++]='.'; }
+	} while(inAbsValue!=0 || (inNumOfDecimals>0 && n<=inNumOfDecimals+1));
+	const int numOfPads=inWidth-n-(inIsNegative ? 1 : 0);
+	int len=0;
+	if(inIsNegative && inPad=='0') { outString[len++]='-'; }
+	for(int i=0; i<numOfPads && len<kMaxNumberLength-n-1; i++) { outString[len++]=inPad; }
+	if(inIsNegative && inPad!='0') { outString[len++]='-'; }
+	while(n>0) { outString[len++]=digits[--n]; }
+	return len;
+}
+// inFracBits in [0,30] and inNumOfDecimals in [0,6].
+static int formatFixed(char *outString,int32_t inValue,int inFracBits,int inNumOfDecimals,
+					   int inWidth,char inPad) {
+	if(inFracBits<0) { inFracBits=0; }
+	if(inFracBits>30) { inFracBits=30; }
+	if(inNumOfDecimals<0) { inNumOfDecimals=0; }
+	if(inNumOfDecimals>6) { inNumOfDecimals=6; }
+	uint64_t scale=1;
+	for(int i=0; i<inNumOfDecimals; i++) { scale*=10; }
+	const uint64_t absValue = inValue<0 ? 0-(int64_t)inValue : inValue;
+	const uint64_t half = inFracBits>0 ? (uint64_t)1<<(inFracBits-1) : 0;
+	uint64_t scaled=(absValue*scale+half)>>inFracBits;
+	if(scaled>UINT32_MAX) { scaled=UINT32_MAX; }
+	return formatNumber(outString,(uint32_t)scaled,inValue<0 && scaled!=0,
+						inNumOfDecimals,inWidth,inPad);
+}
+// ============================== text layer ==============================
+bool t2kInitTextLayer(T2K_TextLayer *outLayer,int inMaxLength,bool inIsOpaque,
+					  uint8_t *inSurfaceArea) {
+	if(inMaxLength<1 || 255<inMaxLength) {
+		ERROR("ERROR t2kInitTextLayer: invalid max length %d.\n",inMaxLength);
+		return false;
+	}
+	const int surfaceSize = inIsOpaque ? inMaxLength*8*8 : inMaxLength*8;
+	const int size=surfaceSize+inMaxLength*2;	// and the rendered chars
+	outLayer->surface=inSurfaceArea;
+	outLayer->surface_needToFree=false;
+	if(inSurfaceArea==NULL) {
+		outLayer->surface=(uint8_t *)malloc(size);
+		if(outLayer->surface==NULL) {
+			ERROR("ERROR t2kInitTextLayer: not enough memory for surface.\n");
+			return false;
+		}
+		outLayer->surface_needToFree=true;
+	}
+	outLayer->chars=outLayer->surface+surfaceSize;
+	outLayer->maxLength=inMaxLength;
+	outLayer->length=0;
+	outLayer->isOpaque=inIsOpaque;
+	outLayer->fgColor=0;
+	outLayer->bgColor=0;
+	outLayer->glyphGeneration=gGlyphGeneration;
+	return true;
+}
+
+void t2kFreeTextLayer(T2K_TextLayer *ioLayer) {
+	if(ioLayer->surface_needToFree) { free(ioLayer->surface); }
+	ioLayer->surface=NULL;
+	ioLayer->chars=NULL;
+	ioLayer->surface_needToFree=false;
+	ioLayer->length=0;
+}
+
+// the string is compared with the rendered chars (kept in the layer, so the
+// caller need not keep it). they are 2 bytes each (the codepoints out of
+// the BMP are the box).
+bool t2kSetTextLayer(T2K_TextLayer *ioLayer,const char *inString,
+					 uint8_t inRGB332,uint8_t inBgRGB332) {
+	if(ioLayer->surface==NULL) { return false; }
+	const int n=ioLayer->maxLength;
+	if(ioLayer->glyphGeneration==gGlyphGeneration && inRGB332==ioLayer->fgColor
+	   && (ioLayer->isOpaque==false || inBgRGB332==ioLayer->bgColor)) {
+		const char *p=inString;
+		int len=0;
+		bool isSame=true;
+		while(*p!='\0' && len<n) {
+			uint32_t c=decodeUTF8(&p);
+			if(0xFFFF<c) { c=0x7F; }
+			if(len==ioLayer->length
+			   || ioLayer->chars[len*2]!=(uint8_t)(c>>8) || ioLayer->chars[len*2+1]!=(uint8_t)c) {
+				isSame=false;
+				break;
+			}
+			len++;
+		}
+		if(isSame && len==ioLayer->length) { return false; }
+	}
+	ioLayer->glyphGeneration=gGlyphGeneration;
+	ioLayer->fgColor=inRGB332;
+	ioLayer->bgColor=inBgRGB332;
+	int len=0;
+	uint8_t buffer[8];
+	while(*inString!='\0' && len<n) {
+		uint32_t c=decodeUTF8(&inString);
+		if(0xFFFF<c) { c=0x7F; }
+		ioLayer->chars[len*2]=(uint8_t)(c>>8);
+		ioLayer->chars[len*2+1]=(uint8_t)c;
+		const uint8_t *pattern=getGlyphOfCodepoint(c,buffer);
+		for(int v=0; v<8; v++) {
+			if( ioLayer->isOpaque ) {
+				uint8_t *dst=ioLayer->surface+(v*n+len)*8;
+				for(int u=0; u<8; u++) {
+					dst[u] = (pattern[v] & (0x80>>u))!=0 ? inRGB332 : inBgRGB332;
+				}
+			} else {
+				ioLayer->surface[v*n+len]=pattern[v];
+			}
+		}
+		len++;
+	}
+	ioLayer->length=len;
+	return true;
+}
+
+// fully visible rows are drawn by a masked store for each char (transparent)
+// or by a memcpy (opaque). only the layers on the edges are clipped.
+void t2kPutTextLayer(const T2K_TextLayer *inLayer,int inX,int inY) {
+	const int n=inLayer->maxLength;
+	const int w=inLayer->length*8;
+	if(inLayer->surface==NULL || w==0) { return; }
+	int startU=0,endU=w;
+	if(inX<0) { startU=-inX; }
+	if(inX+w>kGRamWidth) { endU=kGRamWidth-inX; }
+	if(startU>=endU) { return; }
+	uint8_t *gram=t2kGetFramebuffer();
+	const uint8_t color=inLayer->fgColor;
+	const bool isInside = startU==0 && endU==w;
+	if(isInside) { initGlyphExpansion(); }
+	const uint64_t color64=0x0101010101010101ull*color;
+	for(int v=0; v<8; v++) {
+		const int y=inY+v;
+		if(y<0 || kGRamHeight<=y) { continue; }
+		uint8_t *dst=gram+FBA(inX,y);
+		if( inLayer->isOpaque ) {
+			memcpy(dst+startU,inLayer->surface+v*n*8+startU,endU-startU);
+			continue;
+		}
+		const uint8_t *src=inLayer->surface+v*n;
+		if( isInside ) {
+			for(int i=0; i<inLayer->length; i++,dst+=8) {
+				if(src[i]==0) { continue; }
+				const uint64_t mask=gGlyphExpansion[src[i]];
+				uint64_t row;
+				memcpy(&row,dst,8);
+				row=(row & ~mask) | (color64 & mask);
+				memcpy(dst,&row,8);
+			}
+		} else {
+			for(int u=startU; u<endU; u++) {
+				if((src[u>>3] & (0x80>>(u & 7)))!=0) { dst[u]=color; }
+			}
+		}
+	}
+}
+
+int t2kGetTextLayerWidth(const T2K_TextLayer *inLayer) {
+	return inLayer->length*8;
+}
+
+// ============================== glyph set ==============================
+void t2kSetGlyphSet(const T2K_GlyphSet *inGlyphSet) {
+	gGlyphSet=inGlyphSet;
+	gGlyphGeneration++;
+}
+
+// return U+FFFD for an invalid sequence (and skip a byte).
+static uint32_t decodeUTF8(const char **ioString) {
+	const uint8_t *p=(const uint8_t *)*ioString;
+	uint32_t c=p[0];
+	int n = c<0x80 ? 0 : (c & 0xE0)==0xC0 ? 1 : (c & 0xF0)==0xE0 ? 2 : (c & 0xF8)==0xF0 ? 3 : -1;
+	if(n<0) {
+		(*ioString)++;
+		return 0xFFFD;
+	}
+	c &= 0x7F>>n;
+	for(int i=1; i<=n; i++) {
+		if((p[i] & 0xC0)!=0x80) {	// also stops at '\0'
+			*ioString+=i;
+			return 0xFFFD;
+		}
+		c=c<<6 | (p[i] & 0x3F);
+	}
+	*ioString+=n+1;
+	return c;
+}
+// ASCII from the font, others from the glyph set (by binary search),
+// decompressed into outPattern (8 bytes of the caller, so no state is
+// shared between the cores). undefined chars are the box.
+static const uint8_t *getGlyphOfCodepoint(uint32_t inCodepoint,uint8_t *outPattern) {
+	if(inCodepoint<0x80) { return getGlyph((char)inCodepoint); }
+	const T2K_GlyphSet *glyphSet=gGlyphSet;
+	if(glyphSet==NULL || 0xFFFF<inCodepoint) { return getGlyph(0x7F); }
+	int low=0,high=glyphSet->numOfGlyphs-1;
+	while(low<=high) {
+		const int mid=(low+high)/2;
+		const uint16_t c=glyphSet->codepoints[mid];
+		if(c==inCodepoint) {
+			decompressGlyph(glyphSet->data+glyphSet->offsets[mid],outPattern);
+			return outPattern;
+		}
+		if(c<inCodepoint) { low=mid+1; } else { high=mid-1; }
+	}
+	return getGlyph(0x7F);
+}
+// the first byte has a bit for each row (MSB is the top row). the rows
+// with the bit follow, and the other rows are the same as the row above.
+static void decompressGlyph(const uint8_t *inData,uint8_t *outPattern) {
+	const uint8_t newRows=*inData++;
+	uint8_t row=0;
+	for(int i=0; i<8; i++) {
+		if((newRows & (0x80>>i))!=0) { row=*inData++; }
+		outPattern[i]=row;
+	}
+}
+
+// ============================== packed font ==============================
+// a row of the glyph is read as a word and drawn by 8 pixels with the same
+// masked stores as putPattern (fully visible glyphs only).
+int t2kPutPackedChar(const T2K_PackedFont *inFont,int inX,int inY,uint8_t inRGB332,char inChar) {
+	const T2K_PackedGlyph *glyph=getPackedGlyph(inFont,inChar);
+	const int w=glyph->width;
+	const int h=glyph->height;
+	const int top=inY+glyph->offsetY;
+	if(w==0 || h==0 || inX+w<=0 || kGRamWidth<=inX || top+h<=0 || kGRamHeight<=top) {
+		return glyph->advance;
+	}
+	const uint8_t *bitmap=inFont->bitmap+glyph->offset;
+	uint8_t *gram=t2kGetFramebuffer();
+	const int numOfBytes=(w+7)/8;
+	if(0<=inX && inX+numOfBytes*8<=kGRamWidth && 0<=top && top+h<=kGRamHeight) {
+		initGlyphExpansion();
+		const uint64_t color=0x0101010101010101ull*inRGB332;
+		uint8_t *dstScanline=gram+FBA(inX,top);
+		for(int v=0; v<h; v++,dstScanline+=kGRamWidth) {
+			const uint32_t dots=getBits(bitmap,v*w,w)<<(32-w);	// left aligned
+			if(dots==0) { continue; }
+			for(int i=0; i<numOfBytes; i++) {
+				const uint8_t dots8=dots>>(24-i*8);
+				if(dots8==0) { continue; }
+				const uint64_t mask=gGlyphExpansion[dots8];
+				uint64_t row;
+				memcpy(&row,dstScanline+i*8,8);
+				row=(row & ~mask) | (color & mask);
+				memcpy(dstScanline+i*8,&row,8);
+			}
+		}
+		return glyph->advance;
+	}
+	for(int v=0; v<h; v++) {
+		const int y=top+v;
+		if(y<0 || kGRamHeight<=y) { continue; }
+		const uint32_t dots=getBits(bitmap,v*w,w);
+		for(int u=0; u<w; u++) {
+			const int x=inX+u;
+			if(x<0 || kGRamWidth<=x) { continue; }
+			if((dots>>(w-1-u) & 1)==0) { continue; }
+			gram[FBA(x,y)]=inRGB332;
+		}
+	}
+	return glyph->advance;
+}
+
+int t2kPutPackedStr(const T2K_PackedFont *inFont,int inX,int inY,uint8_t inRGB332,
+					const char *inString) {
+	int x=inX;
+	for(int i=0; inString[i]!='\0'; i++) {
+		x+=t2kPutPackedChar(inFont,x,inY,inRGB332,inString[i]);
+	}
+	return x-inX;
+}
+
+int t2kGetPackedStrWidth(const T2K_PackedFont *inFont,const char *inString) {
+	int width=0;
+	for(int i=0; inString[i]!='\0'; i++) {
+		width+=getPackedGlyph(inFont,inString[i])->advance;
+	}
+	return width;
+}
+
+static const T2K_PackedGlyph *getPackedGlyph(const T2K_PackedFont *inFont,char inChar) {
+	uint8_t c=inChar;
+	if(c<inFont->firstChar || inFont->lastChar<c) { c=inFont->defaultChar; }
+	return inFont->glyphs+(c-inFont->firstChar);
+}
+// inNumOfBits (<=32) bits from the inBitPos-th bit (MSB first).
+static uint32_t getBits(const uint8_t *inBitmap,int inBitPos,int inNumOfBits) {
+	const uint8_t *p=inBitmap+(inBitPos>>3);
+	const int numOfBits=(inBitPos & 7)+inNumOfBits;	// <=39
+	uint64_t bits=0;
+	for(int i=0; i<(numOfBits+7)/8; i++) { bits=bits<<8 | p[i]; }
+	bits>>=(numOfBits+7)/8*8-numOfBits;
+	return (uint32_t)(bits & ((1ull<<inNumOfBits)-1));
+}
+
+static void initGlyphExpansion() {
+	if( gGlyphExpansionIsReady ) { return; }
+	for(int dots=0; dots<256; dots++) {
+		uint64_t bytes=0;
+		for(int i=0; i<8; i++) {
+			if((dots & (0x80>>i))!=0) { bytes|=(uint64_t)0xFF<<(i*8); }
+		}
+		gGlyphExpansion[dots]=bytes;
+	}
+	gGlyphExpansionIsReady=true;
+}
+// a glyph in GRAM is drawn 8 pixels (a row) at a time by a masked store.
+// the glyphs on the edges are clipped pixel by pixel.
+static void putPattern(int inX,int inY,uint8_t inRGB332,const uint8_t *inPattern) {
 	uint8_t *gram=t2kGetFramebuffer();
+	if(0<=inX && inX+8<=kGRamWidth && 0<=inY && inY+8<=kGRamHeight) {
+		initGlyphExpansion();
+		const uint64_t color=0x0101010101010101ull*inRGB332;
+		uint8_t *dst=gram+FBA(inX,inY);
+		for(int i=0; i<8; i++,dst+=kGRamWidth) {
+			const uint8_t dots=inPattern[i];
+			if(dots==0) { continue; }
+			if(dots==0xFF) {
+				memset(dst,inRGB332,8);
+				continue;
+			}
+			const uint64_t mask=gGlyphExpansion[dots];
+			uint64_t row;
+			memcpy(&row,dst,8);		// dst may not be aligned.
+			row=(row & ~mask) | (color & mask);
+			memcpy(dst,&row,8);
+		}
+		return;
+	}
 	int ye=inY+8;
 	int xe=inX+8;
 	for(int y=inY,i=0; y<ye; y++,i++) {
-		if(y<0 || 120<=y) { continue; }
+		if(y<0 || kGRamHeight<=y) { continue; }
 		uint8_t mask=0x80;
 		uint8_t dots=inPattern[i];
 		for(int x=inX; x<xe; x++,mask=mask>>1) {
-			if(x<0 || 160<=x) { continue; }
+			if(x<0 || kGRamWidth<=x) { continue; }
 			if((dots & mask)==0) { continue; }
 			gram[FBA(x,y)]=inRGB332;
 		}
 	}
 }
-
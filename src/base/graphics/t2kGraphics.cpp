@@ -20,37 +20,70 @@
 
 #define sign(x) ((x)<0 ? -1 : (x)>0 ? +1 : 0 )
 
+static void clipSteps(int inStart,int inSign,int inSize,int *ioFirst,int *ioLast);
+static int64_t firstStepOfMinor(int64_t inK,int64_t inMajor,int64_t inMinor);
+
+// the steps along the major axis are clipped to GRAM before drawing
+// (Liang-Barsky on the integer step i, so the pixels are the same as the
+// unclipped Bresenham). after i steps the minor axis has moved
+// k=(2*i*minor+major)/(2*major) pixels.
 void t2kDrawLine(int inX1,int inY1,int inX2,int inY2,uint8_t inRGB332) {
 	if((inX1<0 && inX2<0) || (kGRamWidth<=inX1 && kGRamWidth<=inX2)
 	  || (inY1<0 && inY2<0) || (kGRamHeight<=inY1 && kGRamHeight<=inY2)) {
 		return;
 	}
+	uint8_t *gram=t2kGetFramebuffer();
+	if(inY1==inY2) {	// horizontal
+		const int left =max(min(inX1,inX2),0);
+		const int right=min(max(inX1,inX2),kGRamWidth-1);
+		memset(gram+FBA(left,inY1),inRGB332,right-left+1);
+		return;
+	}
+	if(inX1==inX2) {	// vertical
+		const int top   =max(min(inY1,inY2),0);
+		const int bottom=min(max(inY1,inY2),kGRamHeight-1);
+		uint8_t *p=gram+FBA(inX1,top);
+		for(int y=top; y<=bottom; y++,p+=kGRamWidth) { *p=inRGB332; }
+		return;
+	}
 	const int dx=inX2-inX1;
 	const int dy=inY2-inY1;
-	int x=inX1;
-	int y=inY1;
-	uint8_t *gram=t2kGetFramebuffer();
-	const int absDx=abs(dx);
-	const int absDy=abs(dy);
-	const int signDx=sign(dx);
-	const int signDy=sign(dy);
-	int e,i;
-	if(absDx>absDy) {
-		const float deltaE=2*absDy;
-		const float adjustE=2*absDx;
-		for(i=0,e=-absDx; i<=absDx; i++) {
-			if( isValidXY(x,y) ) { gram[FBA(x,y)]=inRGB332; }
-			x+=signDx; e+=deltaE;
-			if(e>=0) { y+=signDy; e-=adjustE; }
-		}
-	} else {
-		const float deltaE=2*absDx;
-		const float adjustE=2*absDy;
-		for(i=0,e=-absDy; i<=absDy; i++) {
-			if( isValidXY(x,y) ) { gram[FBA(x,y)]=inRGB332; }
-			y+=signDy; e+=deltaE;
-			if(e>=0) { x+=signDx; e-=adjustE; }
-		}
+	const bool isXMajor=abs(dx)>abs(dy);
+	const int major = isXMajor ? abs(dx) : abs(dy);
+	const int minor = isXMajor ? abs(dy) : abs(dx);
+	const int majorStart = isXMajor ? inX1 : inY1;
+	const int minorStart = isXMajor ? inY1 : inX1;
+	const int majorSign  = isXMajor ? sign(dx) : sign(dy);
+	const int minorSign  = isXMajor ? sign(dy) : sign(dx);
+	const int majorSize  = isXMajor ? kGRamWidth  : kGRamHeight;
+	const int minorSize  = isXMajor ? kGRamHeight : kGRamWidth;
+
+	// the steps in GRAM along the major axis.
+	int first=0,last=major;
+	clipSteps(majorStart,majorSign,majorSize,&first,&last);
+	// the steps in GRAM along the minor axis: k in [kFirst,kLast].
+	int kFirst=0,kLast=minor;
+	clipSteps(minorStart,minorSign,minorSize,&kFirst,&kLast);
+	if(kFirst>kLast) { return; }
+	first=(int)max((int64_t)first,firstStepOfMinor(kFirst,major,minor));
+	last =(int)min((int64_t)last, firstStepOfMinor(kLast+1,major,minor)-1);
+	if(first>last) { return; }
+
+	const int64_t k=(2*(int64_t)first*minor+major)/(2*major);
+	int e=(int)(-major+2*(int64_t)first*minor-2*k*major);
+	const int deltaE=2*minor;
+	const int adjustE=2*major;
+	const int majorStep = isXMajor ? majorSign : majorSign*kGRamWidth;
+	const int minorStep = isXMajor ? minorSign*kGRamWidth : minorSign;
+	const int x = isXMajor ? majorStart+majorSign*first : minorStart+minorSign*(int)k;
+	const int y = isXMajor ? minorStart+minorSign*(int)k : majorStart+majorSign*first;
+	uint8_t *p=gram+FBA(x,y);
+	for(int n=last-first; ; n--) {
+		*p=inRGB332;
+		if(n==0) { break; }
+		p+=majorStep;
+		e+=deltaE;
+		if(e>=0) { p+=minorStep; e-=adjustE; }
 	}
 }
 
@@ -88,6 +121,26 @@ void t2kDrawRect(int inX,int inY,int inWidth,int inHeight,uint8_t inRGB332) {
 	}
 }
 
+// narrow [*ioFirst,*ioLast] to the steps i where inStart+inSign*i is in [0,inSize).
+static void clipSteps(int inStart,int inSign,int inSize,int *ioFirst,int *ioLast) {
+	int first,last;
+	if(inSign>0) {
+		first=-inStart;
+		last=inSize-1-inStart;
+	} else {
+		first=inStart-(inSize-1);
+		last=inStart;
+	}
+	*ioFirst=max(*ioFirst,first);
+	*ioLast =min(*ioLast, last);
+}
+// the first step i where the minor axis has moved inK pixels.
+static int64_t firstStepOfMinor(int64_t inK,int64_t inMajor,int64_t inMinor) {
+	if(inK<=0) { return 0; }
+	if(inMinor==0) { return inMajor+1; }	// never
+	return ((2*inK-1)*inMajor+2*inMinor-1)/(2*inMinor);
+}
+
 void t2kDrawCircle(int inX,int inY,int inR,uint8_t inRGB332) {
 	if(inR<=0) { t2kPSet(inX,inY,inRGB332); return; }
 	uint8_t *gram=t2kGetFramebuffer();
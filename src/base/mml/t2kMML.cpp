@@ -22,8 +22,28 @@
 #include <t2kCommon.h>
 #include <t2kSCore.h>
 
+// on the PC, the parser prints every command to stdout.
+// the tools (ex. tools/t2kMmlBench.cpp) build with -DT2K_MML_NO_TRACE.
+#if defined(TEST_ON_PC) && !defined(T2K_MML_NO_TRACE)
+	#define MML_TRACE
+#endif
+
 const int kBufferingMSec=100;
 
+const int kMaxMmlLoops=16;		// num of [...] blocks in a MML string.
+const int kMaxMmlLoopNest=8;
+const int kDefaultMmlLoopCount=2;
+const int kMaxMmlInteger=32767;			// Rational uses int16_t.
+const int kMaxMmlLengthModifiers=8;		// up to "________" or "////////"
+const int kMaxMmlSeekEntries=32;
+const int kDefaultVibratoRateHz=6;
+const int kDefaultArpeggioMSec=50;
+const int kMaxArpeggioSemitones=24;
+const int kMaxVibratoDepthCents=1200;
+const int kMaxVibratoRateHz=50;			// t2kSCore modulates by 250Hz.
+const int kMaxMmlCaches=8;
+const int kMaxMmlCacheMSec=500;
+
 // high word: numerator
 // low  word: denominator
 typedef uint32_t Rational;
@@ -36,8 +56,29 @@ struct MmlState {
 	int currentOctaveIndex;
 	Rational defaultLength;
 	int baseStrength;
-	Rational lengthSubTotal;
+	Rational lengthSubTotal;	// length from the head of the current measure.
+	uint16_t measureCount;
+	uint32_t elapsedMSec;		// sum of tones and rests parsed so far.
 	float unsendRestDurationMSec;
+	int vibratoDepthCents;		// 0 means off
+	int vibratoRateHz;
+	int portamentoMSec;			// 0 means off
+	int arpeggio[2];			// semitones
+	int arpeggioMSec;			// 0 means off
+	float lastFreqHz;			// freq of the last note (for portamento)
+	int loopDepth;
+	uint8_t loopID[kMaxMmlLoopNest];		// index of MmlInfo::loop
+	uint8_t loopRemain[kMaxMmlLoopNest];	// num of passes left (includes current)
+};
+// compiled [ ... | ... ]n block.
+// all indexes are resolved at compile time (see compileMmlLoops),
+// so the player jumps without searching the MML string.
+struct MmlLoop {
+	int openIndex;		// index of '['
+	int breakIndex;		// index of '|' (-1 means no break)
+	int closeIndex;		// index of ']'
+	int exitIndex;		// index of the next char of "]n"
+	uint8_t count;
 };
 struct MmlInfo {
 	bool isAlive;
@@ -45,18 +86,49 @@ struct MmlInfo {
 	int mmlStrLength;
 	int nextMmlCharIndex;
 	int repeatStartIndex;
+	int numOfLoops;
+	MmlLoop loop[kMaxMmlLoops];		// sorted by openIndex
+	uint32_t positionBaseMSec;		// song position at t2kPlayMML or t2kSeekMML
 	bool nowPlaying;
 	bool readyToPlay;
 	MmlState mmlState;
 };
 
+// parse state snapshot at the head of a measure.
+struct MmlSeekEntry {
+	uint32_t timeMSec;
+	int nextMmlCharIndex;
+	int repeatStartIndex;
+	MmlState mmlState;
+};
+// built by the first t2kSeekMML for the song, and kept until other song
+// is seeked on the channel.
+struct MmlSeekIndex {
+	const char *mmlStr;
+	int mmlStrLength;
+	uint32_t songLengthMSec;
+	int32_t repeatStartMSec;	// -1 means no repeat mark '$'.
+	int measureStride;			// num of measures between entries.
+	int numOfEntries;
+	MmlSeekEntry entry[kMaxMmlSeekEntries];		// sorted by timeMSec
+};
+
+// pre-rendered MML (see t2kCacheMML).
+struct MmlCache {
+	const char *mmlStr;		// key (compared by pointer)
+	int8_t *pcm;
+	uint32_t length;
+};
+
 static MmlInfo gMmlInfo[kNumOfChannels];
+static MmlCache gMmlCache[kMaxMmlCaches];
+static MmlSeekIndex *gMmlSeekIndex[kNumOfChannels];
 
 static float gFreqTable[89];	// gFreqTable[88]=0 <- for rest.
 static char gFreqNameStr[89][4];
 
 // ============================== Rational ==============================
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 static void printRational(Rational inRational) {
 	int16_t a=(int16_t)(inRational>>16);
 	int16_t b=(int16_t)(inRational & 0xFFFF);
@@ -73,7 +145,7 @@ static uint32_t MakeRational(int16_t inNumerator,int16_t inDenominator) {
 //}
 static int16_t gcd(int16_t inA,int16_t inB) {
 	if(inA==0) {
-		return inB;
+		return inB!=0 ? inB : 1;	// 1 for 0/0 (avoid zero divide)
 	} else if(inB==0) {
 		return inA;
 	}
@@ -145,6 +217,14 @@ static Rational mul(Rational inR1,Rational inR2) {
 	int16_t t=gcd(x,y);
 	return MakeRational(x/t,y/t);
 }
+static bool isLessThan(Rational inR1,Rational inR2) {
+	// inR1=a/b, inR2=c/d (b>0, d>0)
+	int32_t a=(int16_t)(inR1>>16);
+	int32_t b=(int16_t)(inR1 & 0xFFFF);
+	int32_t c=(int16_t)(inR2>>16);
+	int32_t d=(int16_t)(inR2 & 0xFFFF);
+	return a*d<c*b;
+}
 static float getRationalValue(Rational inRational) {
 	int16_t a=(int16_t)(inRational>>16);
 	int16_t b=(int16_t)(inRational & 0xFFFF);
@@ -155,7 +235,15 @@ static float getRationalValue(Rational inRational) {
 // ============================== MML ==============================
 static void initMML(MmlInfo *outMmlInfo,const char *inMmlStr,int inMmlLength);
 static void initMmlState(MmlState *ioMmlState);
+static bool compileMmlLoops(MmlInfo *ioMmlInfo);
+static int findMmlLoop(const MmlInfo *inMML,int inOpenIndex);
+static MmlSeekIndex *getMmlSeekIndex(int inChannel);
+static bool wrapMmlPosition(const MmlSeekIndex *inIndex,uint32_t *ioMSec);
+static bool buildMmlSeekIndex(MmlSeekIndex *outIndex,const MmlInfo *inMML);
+static void addMmlSeekEntry(MmlSeekIndex *ioIndex,const MmlInfo *inMML);
 static bool registerMML(int inChannel);
+static const MmlCache *findMmlCache(const char *inMmlString);
+static bool renderMML(T2K_PCMRenderer *outRenderer,const char *inMmlString);
 static bool isFinishMML(MmlInfo *inMML);
 static bool checkMML(const char *inMmlString,int inMmlLength);
 static bool parseMmlCommand(MmlInfo *ioMML,
@@ -164,6 +252,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 							float *outFreqHz,
 							int16_t *outDurationMSec,float *outRingTimeScale,
 							uint8_t *outVolume,
+							T2K_ToneModulation *outModulation,
 							bool inIsSupportRepeat=true);
 static int checkNoteCommand(const char *inMmlString,int inStartPos,int inMmlLength,
 							int *outShift,bool *outHasNatural,
@@ -197,8 +286,15 @@ static int checkTempoValue(const char *inMmlString,int inStartPos,int inMmlLengt
 
 static int checkRational(const char *inMmlString,int inStartPos,int inMmlLength,
 						 Rational *outRational);
-static int checkNumber(const char *inMmlString,int inStartPos,float *outNumber);
-static int checkInteger(const char *inMmlString,int inStartPos,int *outIntValue);
+static int checkNumber(const char *inMmlString,int inStartPos,int inMmlLength,
+					   float *outNumber);
+static int checkInteger(const char *inMmlString,int inStartPos,int inMmlLength,
+						int *outIntValue);
+static int checkEffectParams(const char *inMmlString,int inStartPos,int inMmlLength,
+							 int *outValues,int inMaxValues,int *outNumOfValues);
+static int16_t toDurationMSec(float inDurationMSec);
+static uint8_t toVolume(int inStrength);
+static char getMmlChar(const char *inMmlString,int inIndex,int inMmlLength);
 static bool isWhiteSpace(const char inChar);
 static bool isNoteCommand(const char inChar);
 static bool isMmlCommand(const char inChar);
@@ -211,6 +307,8 @@ static void printMmlErrorInfo(const char *inMmlStr,int inIndex,int inMmlLen);
 // white-space : [ \t\n\r] ;
 // mml-command : note-command
 // 			   | tempo-command
+// 			   | loop-command
+// 			   | effect-command
 // note-command : ([A-G]|[a-g]) (white-space* [+-])?
 // 					(white-space* note-length)? (white-space* note-strength)? ;
 // note-length : note-length-term ([+-] note-length-term)* ;
@@ -228,6 +326,24 @@ static void printMmlErrorInfo(const char *inMmlStr,int inIndex,int inMmlLen);
 // note-strength : ':' white-space* [+-]? white-space* INTEGER (white-space* [\'])?
 // 				 | \'
 // 				 ;
+// loop-command : '[' mml ('|' mml)? ']' white-space* INTEGER? ;
+// 		'|' is a break point. the last pass leaves the loop at '|',
+// 		so "[ A | B ]3 C" is played as "A B A B A C" (first/second ending).
+// 		the default loop count is 2, and the loops can be nested up to 8 levels.
+// 		'|' outside of the loops is a bar separator and just ignored.
+// effect-command : '@' white-space* [~] white-space* effect-params	<- vibrato
+// 				  | '@' white-space* [Pp] white-space* effect-params	<- portamento
+// 				  | '@' white-space* [Aa] white-space* effect-params	<- arpeggio
+// 				  ;
+// effect-params : '=' | INTEGER (white-space* ',' white-space* INTEGER)* ;
+// 		@~depth,rate : vibrato. depth in cents (up to 1200), rate in Hz
+// 					   (default 6, up to 50).
+// 		@P msec      : slide from the previous note to the next notes.
+// 		@A n1,n2,msec: arpeggio. play note, note+n1, note+n2 (semitones),
+// 					   each for msec (default 50).
+// 		'=' or 0 (depth, msec, or n1 and n2) turns the effect off.
+// 		the effects are evaluated by t2kSCore, so each note needs
+// 		only one tone in the queue.
 
 bool t2kMmlInit() {
 	gFreqTable[88]=0;	// for rest
@@ -258,7 +374,7 @@ bool t2kMmlInit() {
 
 	for(int i=0; i<kNumOfChannels; i++) { gMmlInfo[i].isAlive=false; }
 
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	for(int i=0; i<89; i++) {
 		printf("i=%d freq=%f name=%s\n",i,gFreqTable[i],gFreqNameStr[i]);
 	}
@@ -284,15 +400,47 @@ bool t2kCheckMML(const char *inMmlString) {
 	return true;
 }
 
+// render a short MML (up to kMaxMmlCacheMSec) once, and t2kPlayMML plays it
+// as a PCM sample without parsing. the cached MML is played on a PCM voice
+// of t2kSCore, so the same MML can be overlapped, and t2kStopMML does not
+// stop it. the repeat mark '$' is ignored (played once).
+// note: the cache is looked up by the pointer, so inMmlString should be
+//		 a constant string (ex. const char *gShoot="T200L32O5 CE";).
+bool t2kCacheMML(const char *inMmlString) {
+	if(findMmlCache(inMmlString)!=NULL) { return true; }
+	MmlCache *cache=NULL;
+	for(int i=0; i<kMaxMmlCaches; i++) {
+		if(gMmlCache[i].mmlStr==NULL) { cache=gMmlCache+i; break; }
+	}
+	if(cache==NULL) {
+		ERROR("ERROR t2kCacheMML: too many caches (max=%d).\n",kMaxMmlCaches);
+		return false;
+	}
+	if(t2kCheckMML(inMmlString)==false) { return false; }
+	T2K_PCMRenderer renderer;
+	if(renderMML(&renderer,inMmlString)==false) { return false; }
+	cache->pcm=renderer.buffer;
+	cache->length=renderer.length;
+	cache->mmlStr=inMmlString;
+	return true;
+}
+
 bool t2kPlayMML(uint8_t inChannel,const char *inMmlString) {
 	if(inChannel>=kNumOfChannels) {
 		ERROR("ERROR t2kPlayMML: invalid channel=%d\n",inChannel);
 		ERROR("                  channel should be in [0,%d).\n",kNumOfChannels);
 		return false;
 	}
+	const MmlCache *cache=findMmlCache(inMmlString);
+	if(cache!=NULL) { return t2kPlayPCM(inChannel,cache->pcm,cache->length); }
+
 	MmlInfo *mml=gMmlInfo+inChannel;
 	int mmlLen=strlen(inMmlString);
 	initMML(mml,inMmlString,mmlLen);
+	if(compileMmlLoops(mml)==false) {
+		mml->isAlive=false;
+		return false;
+	}
 //Serial.printf("musical transposition=%d\n",mml->mmlState.musicalTransposition);
 
 	t2kClearToneSeq(inChannel);
@@ -321,6 +469,95 @@ void t2kStopMMLs() {
 	}
 }
 
+// restart the current MML of the channel from inMSec.
+// the position after the end of the song is wrapped at the repeat mark '$'.
+// the seek index has kMaxMmlSeekEntries snapshots (thinned out for long
+// songs), so after the binary search the song is parsed (without sending
+// tones) from the snapshot to inMSec, up to songLength/kMaxMmlSeekEntries.
+// note: the second and later passes are assumed to be same as the first pass.
+bool t2kSeekMML(uint8_t inChannel,uint32_t inMSec) {
+	if(inChannel>=kNumOfChannels) {
+		ERROR("ERROR t2kSeekMML: invalid channel=%d\n",inChannel);
+		ERROR("                  channel should be in [0,%d).\n",kNumOfChannels);
+		return false;
+	}
+	MmlInfo *mml=gMmlInfo+inChannel;
+	if(mml->mmlStr==NULL) {
+		ERROR("ERROR t2kSeekMML: no MML on channel=%d\n",inChannel);
+		return false;
+	}
+	MmlSeekIndex *index=getMmlSeekIndex(inChannel);
+	if(index==NULL) { return false; }
+
+	uint32_t t=inMSec;
+	if(wrapMmlPosition(index,&t)==false) {
+		return t2kStopMML(inChannel);	// after the end of the song.
+	}
+
+	// find the last entry at or before t.
+	int lo=0,hi=index->numOfEntries-1;
+	while(lo<hi) {
+		int mid=(lo+hi+1)/2;
+		if(index->entry[mid].timeMSec<=t) { lo=mid; } else { hi=mid-1; }
+	}
+	const MmlSeekEntry *entry=index->entry+lo;
+	mml->isAlive=true;
+	mml->nextMmlCharIndex=entry->nextMmlCharIndex;
+	mml->repeatStartIndex=entry->repeatStartIndex;
+	mml->mmlState=entry->mmlState;
+	mml->positionBaseMSec=inMSec;
+	t2kClearToneSeq(inChannel);
+
+	// fast forward to t without sending tones.
+	while(isFinishMML(mml)==false) {
+		uint32_t noteStartMSec=mml->mmlState.elapsedMSec;
+		float freqHz;
+		int16_t durationMSec;
+		float ringTimeScale;
+		uint8_t volume;
+		bool isOutputToneInfo;
+		T2K_ToneModulation modulation;
+		if(parseMmlCommand(mml,NULL,&isOutputToneInfo,
+						   &freqHz,&durationMSec,&ringTimeScale,&volume,
+						   &modulation)==false) {
+			mml->isAlive=false;
+			return false;
+		}
+		if(isOutputToneInfo==false || mml->mmlState.elapsedMSec<=t) { continue; }
+
+		// this note (and its rest) is across t.
+		uint32_t noteEndMSec=noteStartMSec+durationMSec;
+		if(t<noteEndMSec) {
+			t2kAddToneEx(inChannel,freqHz,noteEndMSec-t,volume,&modulation);
+			mml->mmlState.unsendRestDurationMSec=mml->mmlState.elapsedMSec-noteEndMSec;
+		} else {
+			mml->mmlState.unsendRestDurationMSec=mml->mmlState.elapsedMSec-t;
+		}
+		break;
+	}
+	registerMML(inChannel);
+
+	mml->nowPlaying=true;
+	mml->readyToPlay=true;
+	t2kStartToneSeq(inChannel);
+	return true;
+}
+
+// return the song position [msec] of the channel, or -1 if no MML is played.
+// the position of a repeated song is wrapped at '$' as t2kSeekMML (the seek
+// index is built for it by the first call after '$' is parsed).
+int32_t t2kGetMMLPosition(uint8_t inChannel) {
+	if(inChannel>=kNumOfChannels) { return -1; }
+	const MmlInfo *mml=gMmlInfo+inChannel;
+	if(mml->mmlStr==NULL || mml->isAlive==false) { return -1; }
+	uint32_t t=mml->positionBaseMSec+t2kGetToneSeqPlayedMSec(inChannel);
+	if(mml->repeatStartIndex>=0) {
+		const MmlSeekIndex *index=getMmlSeekIndex(inChannel);
+		if(index!=NULL) { wrapMmlPosition(index,&t); }
+	}
+	return t;
+}
+
 void t2kUpdateMML() {
 	bool needUpdateAgain;
 	uint16_t totalDurationMSec[kNumOfChannels];
@@ -341,6 +578,7 @@ void t2kUpdateMML() {
 					continue;
 				} else {
 					mml->nextMmlCharIndex=mml->repeatStartIndex;
+					mml->mmlState.loopDepth=0;
 					// Serial.printf("MML: repeat (restart pos=%d)\n",mml->repeatStartIndex);
 				}
 			}
@@ -353,16 +591,21 @@ void t2kUpdateMML() {
 				continue;
 			}
 
+			// the note may be rejected by the full tone queue, then it is
+			// parsed again later from the same state (ex. lastFreqHz for portamento).
 			int indexBackup=mml->nextMmlCharIndex;
+			const MmlState stateBackup=mml->mmlState;
 			float freqHz;
 			int16_t durationMSec;
 			float ringTimeScale;
 			uint8_t volume;
 			bool hasCommand;
 			bool isOutputToneInfo;
+			T2K_ToneModulation modulation;
 			if(parseMmlCommand(mml,&hasCommand,
 							   &isOutputToneInfo,
-							   &freqHz,&durationMSec,&ringTimeScale,&volume)==false) {
+							   &freqHz,&durationMSec,&ringTimeScale,&volume,
+							   &modulation)==false) {
 				mml->isAlive=false;
 				continue;
 			}	
@@ -372,8 +615,9 @@ void t2kUpdateMML() {
 			}
 			if( isOutputToneInfo ) {
 //Serial.printf("updateMML: ch=%d freq=%f duration=%d volume=%d\n",ch,freqHz,durationMSec,volume);
-				if(t2kAddTone(ch,freqHz,durationMSec,volume)==false) {
+				if(t2kAddToneEx(ch,freqHz,durationMSec,volume,&modulation)==false) {
 					mml->nextMmlCharIndex=indexBackup;
+					mml->mmlState=stateBackup;
 					mml->mmlState.unsendRestDurationMSec=-1; // cansel rest.
 					scoreQueueIsFull[ch]=true;
 				} else {
@@ -410,6 +654,8 @@ static void initMML(MmlInfo *outMmlInfo,const char *inMmlStr,int inMmlLength) {
 	outMmlInfo->mmlStrLength=inMmlLength;
 	outMmlInfo->nextMmlCharIndex=0;
 	outMmlInfo->repeatStartIndex=-1;
+	outMmlInfo->numOfLoops=0;
+	outMmlInfo->positionBaseMSec=0;
 	outMmlInfo->nowPlaying=false;
 	outMmlInfo->readyToPlay=false;
 	initMmlState(&outMmlInfo->mmlState);
@@ -423,7 +669,246 @@ static void initMmlState(MmlState *ioMmlState) {
 	ioMmlState->defaultLength=MakeRational(1,4);
 	ioMmlState->baseStrength=90;
 	ioMmlState->lengthSubTotal=MakeRational(0,1);
+	ioMmlState->measureCount=0;
+	ioMmlState->elapsedMSec=0;
 	ioMmlState->unsendRestDurationMSec=0;
+	ioMmlState->vibratoDepthCents=0;
+	ioMmlState->vibratoRateHz=kDefaultVibratoRateHz;
+	ioMmlState->portamentoMSec=0;
+	ioMmlState->arpeggio[0]=ioMmlState->arpeggio[1]=0;
+	ioMmlState->arpeggioMSec=0;
+	ioMmlState->lastFreqHz=0;
+	ioMmlState->loopDepth=0;
+}
+// resolve all '[', '|' and ']' to MmlLoop.
+// note: the loop table is built once per t2kPlayMML, and the player uses
+//		 only the indexes in the table to jump.
+static bool compileMmlLoops(MmlInfo *ioMmlInfo) {
+	const char *mmlStr=ioMmlInfo->mmlStr;
+	const int mmlLen=ioMmlInfo->mmlStrLength;
+	int stack[kMaxMmlLoopNest];
+	int depth=0;
+	ioMmlInfo->numOfLoops=0;
+	for(int i=0; i<mmlLen; i++) {
+		char c=getMmlChar(mmlStr,i,mmlLen);
+		if(c=='%') { break; }	// the rest is comment.
+		switch(c) {
+			case '[': {
+					if(depth>=kMaxMmlLoopNest) {
+						ERROR("MML ERROR: loops are nested too deeply (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					if(ioMmlInfo->numOfLoops>=kMaxMmlLoops) {
+						ERROR("MML ERROR: too many loops (max=%d, index=%d).\n",
+							  kMaxMmlLoops,i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					MmlLoop *loop=ioMmlInfo->loop+ioMmlInfo->numOfLoops;
+					loop->openIndex=i;
+					loop->breakIndex=-1;
+					loop->closeIndex=-1;
+					loop->exitIndex=-1;
+					loop->count=kDefaultMmlLoopCount;
+					stack[depth++]=ioMmlInfo->numOfLoops++;
+				}
+				break;
+			case '|':
+				if(depth>0) {
+					MmlLoop *loop=ioMmlInfo->loop+stack[depth-1];
+					if(loop->breakIndex>=0) {
+						ERROR("MML ERROR: loop has two or more '|' (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					loop->breakIndex=i;
+				}
+				break;
+			case ']': {
+					if(depth==0) {
+						ERROR("MML ERROR: ']' without '[' (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					MmlLoop *loop=ioMmlInfo->loop+stack[--depth];
+					loop->closeIndex=i;
+					int t=skipWhiteSpace(mmlStr,i+1,mmlLen);
+					c=getMmlChar(mmlStr,t,mmlLen);
+					if('0'<=c && c<='9') {
+						int count;
+						t=checkInteger(mmlStr,t,mmlLen,&count);
+						if(t<0 || count<1 || 255<count) {
+							ERROR("MML ERROR: loop count should be in [1,255] "
+								  "(index=%d).\n",i);
+							printMmlErrorInfo(mmlStr,i,mmlLen);
+							return false;
+						}
+						loop->count=(uint8_t)count;
+					}
+					loop->exitIndex=t;
+					i=t-1;
+				}
+				break;
+			case '$':
+				if(depth>0) {
+					ERROR("MML ERROR: repeat mark '$' in loop (index=%d).\n",i);
+					printMmlErrorInfo(mmlStr,i,mmlLen);
+					return false;
+				}
+				break;
+		}
+	}
+	if(depth>0) {
+		int i=ioMmlInfo->loop[stack[depth-1]].openIndex;
+		ERROR("MML ERROR: '[' without ']' (index=%d).\n",i);
+		printMmlErrorInfo(mmlStr,i,mmlLen);
+		return false;
+	}
+	return true;
+}
+static MmlSeekIndex *getMmlSeekIndex(int inChannel) {
+	const MmlInfo *mml=gMmlInfo+inChannel;
+	MmlSeekIndex *index=gMmlSeekIndex[inChannel];
+	if(index!=NULL && index->mmlStr==mml->mmlStr
+	   && index->mmlStrLength==mml->mmlStrLength) {
+		return index;
+	}
+	if(index==NULL) {
+		index=(MmlSeekIndex *)malloc(sizeof(MmlSeekIndex));
+		if(index==NULL) {
+			ERROR("ERROR t2kSeekMML: not enough memory for seek index.\n");
+			return NULL;
+		}
+		gMmlSeekIndex[inChannel]=index;
+	}
+	if(buildMmlSeekIndex(index,mml)==false) {
+		index->mmlStr=NULL;
+		return NULL;
+	}
+	return index;
+}
+// wrap *ioMSec after the end of the song at the repeat mark '$'.
+// false if it is after the end of the song without '$'.
+static bool wrapMmlPosition(const MmlSeekIndex *inIndex,uint32_t *ioMSec) {
+	if(*ioMSec<inIndex->songLengthMSec) { return true; }
+	if(inIndex->repeatStartMSec<0
+	   || inIndex->songLengthMSec<=(uint32_t)inIndex->repeatStartMSec) {
+		return false;
+	}
+	uint32_t loopLength=inIndex->songLengthMSec-inIndex->repeatStartMSec;
+	*ioMSec=inIndex->repeatStartMSec+(*ioMSec-inIndex->repeatStartMSec)%loopLength;
+	return true;
+}
+// parse whole song once, and take a snapshot at the head of each measure.
+// if the song has many measures, the entries are thinned out to every
+// 2, 4, 8, ... measures.
+static bool buildMmlSeekIndex(MmlSeekIndex *outIndex,const MmlInfo *inMML) {
+	MmlInfo mml;
+	initMML(&mml,inMML->mmlStr,inMML->mmlStrLength);
+	mml.numOfLoops=inMML->numOfLoops;
+	memcpy(mml.loop,inMML->loop,sizeof(MmlLoop)*inMML->numOfLoops);
+
+	outIndex->mmlStr=inMML->mmlStr;
+	outIndex->mmlStrLength=inMML->mmlStrLength;
+	outIndex->repeatStartMSec=-1;
+	outIndex->measureStride=1;
+	outIndex->numOfEntries=0;
+	addMmlSeekEntry(outIndex,&mml);
+	while(isFinishMML(&mml)==false) {
+		uint16_t measureCount=mml.mmlState.measureCount;
+		if(parseMmlCommand(&mml,NULL,NULL,NULL,NULL,NULL,NULL,NULL)==false) {
+			return false;
+		}
+		if(mml.repeatStartIndex>=0 && outIndex->repeatStartMSec<0) {
+			outIndex->repeatStartMSec=mml.mmlState.elapsedMSec;
+		}
+		if(mml.mmlState.measureCount!=measureCount
+		   && mml.mmlState.measureCount%outIndex->measureStride==0) {
+			addMmlSeekEntry(outIndex,&mml);
+		}
+	}
+	outIndex->songLengthMSec=mml.mmlState.elapsedMSec;
+	return true;
+}
+static void addMmlSeekEntry(MmlSeekIndex *ioIndex,const MmlInfo *inMML) {
+	if(ioIndex->numOfEntries>=kMaxMmlSeekEntries) {
+		// keep entry[0], entry[2], entry[4], ...
+		int n=0;
+		for(int i=0; i<ioIndex->numOfEntries; i+=2) {
+			ioIndex->entry[n++]=ioIndex->entry[i];
+		}
+		ioIndex->numOfEntries=n;
+		ioIndex->measureStride*=2;
+		if(inMML->mmlState.measureCount%ioIndex->measureStride!=0) { return; }
+	}
+	MmlSeekEntry *entry=ioIndex->entry+ioIndex->numOfEntries++;
+	entry->timeMSec=inMML->mmlState.elapsedMSec;
+	entry->nextMmlCharIndex=inMML->nextMmlCharIndex;
+	entry->repeatStartIndex=inMML->repeatStartIndex;
+	entry->mmlState=inMML->mmlState;
+}
+static const MmlCache *findMmlCache(const char *inMmlString) {
+	for(int i=0; i<kMaxMmlCaches; i++) {
+		if(gMmlCache[i].mmlStr==inMmlString) { return gMmlCache+i; }
+	}
+	return NULL;
+}
+// parse twice. the first pass is for the length of the PCM buffer.
+static bool renderMML(T2K_PCMRenderer *outRenderer,const char *inMmlString) {
+	MmlInfo mml;
+	initMML(&mml,inMmlString,strlen(inMmlString));
+	if(compileMmlLoops(&mml)==false) { return false; }
+	while(isFinishMML(&mml)==false) {
+		if(parseMmlCommand(&mml,NULL,NULL,NULL,NULL,NULL,NULL,NULL)==false) {
+			return false;
+		}
+	}
+	uint32_t lengthMSec=mml.mmlState.elapsedMSec;
+	if(lengthMSec==0 || lengthMSec>(uint32_t)kMaxMmlCacheMSec) {
+		ERROR("ERROR t2kCacheMML: length should be in (0,%d] msec (length=%u).\n",
+			  kMaxMmlCacheMSec,lengthMSec);
+		return false;
+	}
+	if(t2kInitPCMRenderer(outRenderer,lengthMSec)==false) { return false; }
+
+	int numOfLoops=mml.numOfLoops;
+	initMML(&mml,inMmlString,mml.mmlStrLength);
+	mml.numOfLoops=numOfLoops;	// mml.loop is not changed by initMML.
+	while(isFinishMML(&mml)==false) {
+		float freqHz;
+		int16_t durationMSec;
+		float ringTimeScale;
+		uint8_t volume;
+		bool isOutputToneInfo;
+		T2K_ToneModulation modulation;
+		if(parseMmlCommand(&mml,NULL,&isOutputToneInfo,
+						   &freqHz,&durationMSec,&ringTimeScale,&volume,
+						   &modulation)==false) {
+			break;
+		}
+		if(isOutputToneInfo==false) { continue; }
+		if(ringTimeScale>1) { ringTimeScale=1; }
+		t2kRenderTone(outRenderer,freqHz,durationMSec,volume,&modulation);
+		if(ringTimeScale<1) {
+			t2kRenderTone(outRenderer,0,(int16_t)(durationMSec*(1-ringTimeScale)),0,NULL);
+		}
+	}
+	if(isFinishMML(&mml)==false) {
+		free(outRenderer->buffer);
+		return false;
+	}
+	return true;
+}
+static int findMmlLoop(const MmlInfo *inMML,int inOpenIndex) {
+	int lo=0,hi=inMML->numOfLoops-1;
+	while(lo<=hi) {
+		int mid=(lo+hi)/2;
+		int t=inMML->loop[mid].openIndex;
+		if(t==inOpenIndex) { return mid; }
+		if(t<inOpenIndex) { lo=mid+1; } else { hi=mid-1; }
+	}
+	return -1;
 }
 static bool registerMML(int inChannel) {
 	float freqHz;
@@ -432,10 +917,12 @@ static bool registerMML(int inChannel) {
 	uint8_t volume;
 	bool hasCommand;
 	bool isOutputToneInfo;
+	T2K_ToneModulation modulation;
 	bool isAnyCommands=false;
 	MmlInfo *mml=gMmlInfo+inChannel;
 
-	int16_t totalDurationMSec=0;
+	int totalDurationMSec=0;
+	int totalDurationMSecAtRepeat=-1;
 
 again:
 	while(isFinishMML(mml)==false) {
@@ -447,9 +934,11 @@ again:
 			}
 		}
 		int i=mml->nextMmlCharIndex;
+		const MmlState stateBackup=mml->mmlState;
 		if(parseMmlCommand(mml,&hasCommand,
 						   &isOutputToneInfo,
-						   &freqHz,&durationMSec,&ringTimeScale,&volume)==false) {
+						   &freqHz,&durationMSec,&ringTimeScale,&volume,
+						   &modulation)==false) {
 			mml->nextMmlCharIndex=i;
 			return false;
 		}			
@@ -459,8 +948,9 @@ again:
 			mml->mmlState.unsendRestDurationMSec=durationMSec*(1-ringTimeScale);			
 		}
 		if( isOutputToneInfo ) {
-			if(t2kAddTone(inChannel,freqHz,durationMSec,volume)==false) {
+			if(t2kAddToneEx(inChannel,freqHz,durationMSec,volume,&modulation)==false) {
 				mml->nextMmlCharIndex=i;
+				mml->mmlState=stateBackup;
 				mml->mmlState.unsendRestDurationMSec=-1;
 				return true;
 			}
@@ -470,8 +960,14 @@ again:
 			}
 		}
 	}
-	if( isFinishMML(mml) && mml->repeatStartIndex>=0) {
+	// note: do not repeat if buffered enough (t2kUpdateMML will do it),
+	//		 or the last pass had no tones (ex. "$ @V90").
+	if(isFinishMML(mml) && mml->repeatStartIndex>=0
+	   && totalDurationMSec<=kBufferingMSec
+	   && totalDurationMSec!=totalDurationMSecAtRepeat) {
+		totalDurationMSecAtRepeat=totalDurationMSec;
 		mml->nextMmlCharIndex=mml->repeatStartIndex;
+		mml->mmlState.loopDepth=0;
 		goto again;
 	}
 	return isAnyCommands;
@@ -484,6 +980,7 @@ static bool checkMML(const char *inMmlString,int inMmlLength) {
 
 	MmlInfo mml;
 	initMML(&mml,inMmlString,inMmlLength);
+	if(compileMmlLoops(&mml)==false) { return false; }
 
 	float freqHz;
 	int16_t durationMSec;
@@ -495,9 +992,9 @@ static bool checkMML(const char *inMmlString,int inMmlLength) {
 	while(isFinishMML(&mml)==false) {
 		if(parseMmlCommand(&mml,&hasCommand,
 						   &isOutputToneInfo,
-						   &freqHz,&durationMSec,&ringTimeScale,&volume,
+						   &freqHz,&durationMSec,&ringTimeScale,&volume,NULL,
 						   false)==false) {
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("ERROR at index=%d\n",mml.nextMmlCharIndex);
 #endif
 			return false;
@@ -512,17 +1009,22 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 							float *outFreqHz,
 							int16_t *outDurationMSec,float *outRingTimeScale,
 							uint8_t *outVolume,
+							T2K_ToneModulation *outModulation,
 							bool inIsSupportRepeat) {
 	int i=ioMML->nextMmlCharIndex;
 	const char *mmlStr=ioMML->mmlStr;
 	int mmlLen=ioMML->mmlStrLength;
 	i=skipWhiteSpace(mmlStr,i,mmlLen);
 	if(i>=mmlLen) {
+		ioMML->nextMmlCharIndex=i;
 		if(outHasCommand!=NULL) { *outHasCommand=false; }
+		if(outIsOutputToneInfo!=NULL) { *outIsOutputToneInfo=false; }
+		if(outRingTimeScale!=NULL) { *outRingTimeScale=1; }
 		return true;
 	}
-	if(isMmlCommand(mmlStr[i])==false) {
-		ERROR("MML ERROR: invalid MML command '%c' (index=%d).\n",mmlStr[i],i);
+	char c=getMmlChar(mmlStr,i,mmlLen);
+	if(isMmlCommand(c)==false) {
+		ERROR("MML ERROR: invalid MML command '%c' (index=%d).\n",c,i);
 		printMmlErrorInfo(mmlStr,i,mmlLen);
 		return false;
 	}
@@ -533,7 +1035,6 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 	float ringTimeScale=0;
 	uint8_t volume=0;
 
-	char c=mmlStr[i];
 	if( isNoteCommand(c) || c=='R' || c=='r') {
 		char noteCommand=c;
 		int offset;
@@ -548,7 +1049,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			return false;
 		}
 		i=skipWhiteSpace(mmlStr,i+1,mmlLen);
-		c=mmlStr[i];
+		c=getMmlChar(mmlStr,i,mmlLen);
 		int tmpOctaveShift=0;
 		if(c=='^') {
 			tmpOctaveShift=12;
@@ -575,9 +1076,14 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 		if(hasNatural) {
 			offset=getNoteOffset(noteCommand,0);	// natural
 			i=skipWhiteSpace(mmlStr,i,mmlLen);		// i indexed next term already.
-			c=mmlStr[i];
+			c=getMmlChar(mmlStr,i,mmlLen);
+		}
+		MmlState *state=&ioMML->mmlState;
+		state->lengthSubTotal=add(state->lengthSubTotal,noteLength);
+		while(isLessThan(state->lengthSubTotal,state->musicBeat)==false) {
+			state->lengthSubTotal=sub(state->lengthSubTotal,state->musicBeat);
+			state->measureCount++;
 		}
-		ioMML->mmlState.lengthSubTotal=add(ioMML->mmlState.lengthSubTotal,noteLength);
 		int freqIndex;
 		if(offset!=88) {
 			freqIndex=ioMML->mmlState.currentOctaveIndex+tmpOctaveShift+offset+shift;
@@ -592,10 +1098,11 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 
 		isOutputToneInfo=true;
 		freqHz=gFreqTable[freqIndex];
-		durationMSec=getRationalValue(noteLength)*4*60/ioMML->mmlState.tempo*1000;
-		volume=(uint8_t)(strength/127.0*255);
+		durationMSec=toDurationMSec(getRationalValue(noteLength)*4*60
+									/ioMML->mmlState.tempo*1000);
+		volume=toVolume(strength);
 
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("octave=%d offset=%d shift=%d\n",
 		   ioMML->mmlState.currentOctaveIndex,offset,shift);
 	printf("Note=%s\n",gFreqNameStr[freqIndex]);
@@ -606,7 +1113,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 #endif
 	} else if(c=='@') {
 		i=skipWhiteSpace(mmlStr,i+1,mmlLen);
-		c=mmlStr[i];
+		c=getMmlChar(mmlStr,i,mmlLen);
 		switch(c) {
 			case 'K':	// @K or @k
 			case 'k': {
@@ -621,18 +1128,19 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			case 't': {
 					i=skipWhiteSpace(mmlStr,i+1,mmlLen);
 					int numerator;
-					i=checkInteger(mmlStr,i,&numerator);
+					i=checkInteger(mmlStr,i,mmlLen,&numerator);
 					if(i<0) { return false; }
 					i=skipWhiteSpace(mmlStr,i,mmlLen);
-					c=mmlStr[i];
+					c=getMmlChar(mmlStr,i,mmlLen);
 					if(c!='/') { return false; }
 					i=skipWhiteSpace(mmlStr,i+1,mmlLen);
 					int denominator;
-					i=checkInteger(mmlStr,i,&denominator);
+					i=checkInteger(mmlStr,i,mmlLen,&denominator);
 					if(i<0) { return false; }
 					if(denominator!=4 && denominator!=8) { return false; }	
+					if(numerator<=0) { return false; }
 					ioMML->mmlState.musicBeat=MakeRational(numerator,denominator);
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("music beat=%d/%d\n",numerator,denominator);
 #endif
 				}
@@ -641,7 +1149,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			case 'm': {
 					i=skipWhiteSpace(mmlStr,i+1,mmlLen);
 					// int startPos=i;
-					c=mmlStr[i];
+					c=getMmlChar(mmlStr,i,mmlLen);
 					if(c=='=') {
 						if(ioMML->mmlState.initialTempo<0) {
 							ioMML->mmlState.initialTempo=120;
@@ -673,7 +1181,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 						}
 						ioMML->mmlState.tempo=tempoValue;
 					}
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("tempo=%f\n",ioMML->mmlState.tempo);
 #endif
 				}
@@ -683,12 +1191,56 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 					int baseStrength;
 					i=checkBaseStrength(mmlStr,i+1,mmlLen,&baseStrength);
 					if(i<0) { return false; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("Set Default Strength: %d\n",baseStrength);
 #endif
 					ioMML->mmlState.baseStrength=baseStrength;
 				}
 				break;
+			case '~': {	// @~ : vibrato
+					int param[2]={ 0, kDefaultVibratoRateHz };
+					int n;
+					i=checkEffectParams(mmlStr,i+1,mmlLen,param,2,&n);
+					if(i<0) { return false; }
+					if(param[0]>kMaxVibratoDepthCents || param[1]<=0 || param[1]>kMaxVibratoRateHz) {
+						ERROR("MML ERROR: invalid vibrato (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					ioMML->mmlState.vibratoDepthCents=param[0];
+					ioMML->mmlState.vibratoRateHz=param[1];
+				}
+				break;
+			case 'P':	// @P or @p : portamento
+			case 'p': {
+					int msec=0;
+					int n;
+					i=checkEffectParams(mmlStr,i+1,mmlLen,&msec,1,&n);
+					if(i<0) { return false; }
+					ioMML->mmlState.portamentoMSec=msec;
+				}
+				break;
+			case 'A':	// @A or @a : arpeggio
+			case 'a': {
+					int param[3]={ 0, 0, kDefaultArpeggioMSec };
+					int n;
+					i=checkEffectParams(mmlStr,i+1,mmlLen,param,3,&n);
+					if(i<0) { return false; }
+					if(param[0]>kMaxArpeggioSemitones || param[1]>kMaxArpeggioSemitones) {
+						ERROR("MML ERROR: arpeggio should be in [0,%d] (index=%d).\n",
+							  kMaxArpeggioSemitones,i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					ioMML->mmlState.arpeggio[0]=param[0];
+					ioMML->mmlState.arpeggio[1]=param[1];
+					ioMML->mmlState.arpeggioMSec= param[0]==0 && param[1]==0 ? 0 : param[2];
+				}
+				break;
+			default:
+				ERROR("MML ERROR: unknown command '@%c' (index=%d).\n",c,i);
+				printMmlErrorInfo(mmlStr,i,mmlLen);
+				return false;
 		}
 	} else {
 		isOutputToneInfo=false;
@@ -696,12 +1248,14 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			case '%': i=ioMML->mmlStrLength; break;
 			case '&': // just ignore
 				i++; break;
+			case '!': // callback (not supported yet, just ignore)
+				i++; break;
 			case 'O':
 			case 'o': {
 					int octaveIndex;
 					i=checkOctaveCommand(mmlStr,i+1,mmlLen,&octaveIndex);
 					if(i<0) { return false; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("OCTAVE COMMAND: now octaveLevelIndex=%d\n",octaveIndex);
 #endif
 					ioMML->mmlState.currentOctaveIndex=octaveIndex;
@@ -710,7 +1264,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			case '<': {
 					int octaveIndex=ioMML->mmlState.currentOctaveIndex+12;
 					if(octaveIndex>87) { octaveIndex=87; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("OCTAVE UP: now octaveLevelIndex %d ->%d\n",ioMML->mmlState.currentOctaveIndex,octaveIndex);
 #endif
 					ioMML->mmlState.currentOctaveIndex=octaveIndex;
@@ -720,7 +1274,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			case '>': {
 					int octaveIndex=ioMML->mmlState.currentOctaveIndex-12;
 					if(octaveIndex<-9) { octaveIndex=-9; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("OCTAVE DOWN: now octaveLevelIndex=%d\n",octaveIndex);
 #endif
 					ioMML->mmlState.currentOctaveIndex=octaveIndex;
@@ -733,7 +1287,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 					i=checkNoteLength(mmlStr,i+1,mmlLen,
 									  &defaultLength,ioMML->mmlState.defaultLength);
 					if(i<0) { return false; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("Set Default Length: "); printRational(defaultLength);
 #endif
 					ioMML->mmlState.defaultLength=defaultLength;
@@ -744,7 +1298,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 					int baseStrength;
 					i=checkBaseStrength(mmlStr,i+1,mmlLen,&baseStrength);
 					if(i<0) { return false; }
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("Set Default Strength: %d\n",baseStrength);
 #endif
 					ioMML->mmlState.baseStrength=baseStrength;
@@ -754,13 +1308,14 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 			// ex: N440 <-- A
 			case 'N':
 			case 'n': {
-					i=checkNumber(mmlStr,i+1,&freqHz);
+					i=checkNumber(mmlStr,i+1,mmlLen,&freqHz);
 					if(i<0) { return false; }
 					isOutputToneInfo=true;
-					durationMSec=getRationalValue(ioMML->mmlState.defaultLength)*4*60
-								 /ioMML->mmlState.tempo*1000;
+					durationMSec=toDurationMSec(
+								getRationalValue(ioMML->mmlState.defaultLength)*4*60
+								/ioMML->mmlState.tempo*1000);
 					ringTimeScale=1;
-					volume=(uint8_t)(ioMML->mmlState.baseStrength/127.0*255);
+					volume=toVolume(ioMML->mmlState.baseStrength);
 				}
 				break;
 			case 'T':
@@ -773,7 +1328,7 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 						ioMML->mmlState.initialTempo=tempoValue;
 					}
 					ioMML->mmlState.tempo=tempoValue;
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("tempo=%f\n",ioMML->mmlState.tempo);
 #endif
 				}
@@ -786,9 +1341,67 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 					ioMML->repeatStartIndex=i;
 				}
 				break;
+			case '[': {
+					if(inIsSupportRepeat==false) { i++; break; }	// check only
+					MmlState *state=&ioMML->mmlState;
+					int loopID=findMmlLoop(ioMML,i);
+					if(loopID<0 || state->loopDepth>=kMaxMmlLoopNest) {
+						ERROR("MML ERROR: uncompiled loop (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					state->loopID[state->loopDepth]=loopID;
+					state->loopRemain[state->loopDepth]=ioMML->loop[loopID].count;
+					state->loopDepth++;
+					i++;
+				}
+				break;
+			case '|': {
+					MmlState *state=&ioMML->mmlState;
+					if(inIsSupportRepeat==false || state->loopDepth==0) { i++; break; }
+					int top=state->loopDepth-1;
+					const MmlLoop *loop=ioMML->loop+state->loopID[top];
+					if(state->loopRemain[top]<=1) {	// last pass
+						state->loopDepth--;
+						i=loop->exitIndex;
+					} else {
+						i++;
+					}
+				}
+				break;
+			case ']': {
+					MmlState *state=&ioMML->mmlState;
+					if(inIsSupportRepeat==false) {	// check only
+						i=skipWhiteSpace(mmlStr,i+1,mmlLen);
+						i=checkInteger(mmlStr,i,mmlLen,NULL);
+						if(i<0) { return false; }
+						break;
+					}
+					if(state->loopDepth==0) {
+						ERROR("MML ERROR: ']' without '[' (index=%d).\n",i);
+						printMmlErrorInfo(mmlStr,i,mmlLen);
+						return false;
+					}
+					int top=state->loopDepth-1;
+					const MmlLoop *loop=ioMML->loop+state->loopID[top];
+					if(--state->loopRemain[top]>0) {
+						i=loop->openIndex+1;
+					} else {
+						state->loopDepth--;
+						i=loop->exitIndex;
+					}
+				}
+				break;
 		}
 	}
 	ioMML->nextMmlCharIndex=i;
+	if( isOutputToneInfo ) {
+		// same as the rest sent by registerMML and t2kUpdateMML.
+		ioMML->mmlState.elapsedMSec+=durationMSec;
+		if(ringTimeScale<1) {
+			ioMML->mmlState.elapsedMSec+=(int16_t)(durationMSec*(1-ringTimeScale));
+		}
+	}
 
 	if(outHasCommand!=NULL) { *outHasCommand=true; }
 	if(outIsOutputToneInfo!=NULL) { *outIsOutputToneInfo=isOutputToneInfo; }
@@ -796,6 +1409,22 @@ static bool parseMmlCommand(MmlInfo *ioMML,
 	if(outDurationMSec!=NULL) { *outDurationMSec=durationMSec; }
 	if(outRingTimeScale!=NULL) { *outRingTimeScale=ringTimeScale; }
 	if(outVolume!=NULL) { *outVolume=volume; }
+	if(outModulation!=NULL) {
+		const MmlState *state=&ioMML->mmlState;
+		memset(outModulation,0,sizeof(T2K_ToneModulation));
+		if(isOutputToneInfo && freqHz>0) {
+			outModulation->vibratoDepthCents=state->vibratoDepthCents;
+			outModulation->vibratoRateHz=state->vibratoRateHz;
+			if(state->portamentoMSec>0 && state->lastFreqHz>0 && state->lastFreqHz!=freqHz) {
+				outModulation->portamentoFromHz=state->lastFreqHz;
+				outModulation->portamentoMSec=state->portamentoMSec;
+			}
+			outModulation->arpeggio[0]=state->arpeggio[0];
+			outModulation->arpeggio[1]=state->arpeggio[1];
+			outModulation->arpeggioMSec=state->arpeggioMSec;
+		}
+	}
+	if(isOutputToneInfo && freqHz>0) { ioMML->mmlState.lastFreqHz=freqHz; }
 	return true;
 }
 // inMmlString[inStartPos-1] is in [A-G] or [a-g] or R or r.
@@ -812,13 +1441,15 @@ static int checkNoteCommand(const char *inMmlString,int inStartPos,int inMmlLeng
 	bool hasNatural=false;
 
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	char c=inMmlString[i];
+	char c=getMmlChar(inMmlString,i,inMmlLength);
 	if(c=='+') {
-		for(; inMmlString[i]=='+'; i=skipWhiteSpace(inMmlString,i+1,inMmlLength)) {
+		for(; getMmlChar(inMmlString,i,inMmlLength)=='+';
+			  i=skipWhiteSpace(inMmlString,i+1,inMmlLength)) {
 			shift++;
 		}
 	} else if(c=='-') {
-		for(; inMmlString[i]=='-'; i=skipWhiteSpace(inMmlString,i+1,inMmlLength)) {
+		for(; getMmlChar(inMmlString,i,inMmlLength)=='-';
+			  i=skipWhiteSpace(inMmlString,i+1,inMmlLength)) {
 			shift--;
 		}
 	} else if(c=='=') {
@@ -830,24 +1461,24 @@ static int checkNoteCommand(const char *inMmlString,int inStartPos,int inMmlLeng
 	if(i<0) { return -1; }
 
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	if(inMmlString[i]=='*') {
+	if(getMmlChar(inMmlString,i,inMmlLength)=='*') {
 		i++;
 		i=skipWhiteSpace(inMmlString,i,inMmlLength);
-		i=checkNumber(inMmlString,i,&ringTime);
+		i=checkNumber(inMmlString,i,inMmlLength,&ringTime);
 		if(i<0) { return -1; }
 	}	
 
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	if(inMmlString[i]==':') {
+	if(getMmlChar(inMmlString,i,inMmlLength)==':') {
 		i++;
 		i=skipWhiteSpace(inMmlString,i,inMmlLength);
 		i=checkNoteStrength(inMmlString,i,inMmlLength,&strength,inBaseStrength);
 		if(i<0) { return -1; }
-	} else if(inMmlString[i]=='\'') {
+	} else if(getMmlChar(inMmlString,i,inMmlLength)=='\'') {
 		i++;
 		strength=inBaseStrength+20;
 	}
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("checkNoteCommand::noteLength=");printRational(noteLength);
 	printf("                  ringTime=%f\n",ringTime);
 	printf("                  strength=%d\n",strength);
@@ -867,11 +1498,11 @@ static int checkMusicalTransposition(const char *inMmlStr,int inStartPos,int inM
 	int i=inStartPos;
 	int musicalTransposition;
 	i=skipWhiteSpace(inMmlStr,i,inMmlLen);
-	char c=inMmlStr[i];
+	char c=getMmlChar(inMmlStr,i,inMmlLen);
 	if(c=='+') {
 // Serial.printf("checkMusicalTransposition[+] - IN index=%d\n",inStartPos);
 		i=skipWhiteSpace(inMmlStr,i+1,inMmlLen);
-		i=checkInteger(inMmlStr,i,&musicalTransposition);
+		i=checkInteger(inMmlStr,i,inMmlLen,&musicalTransposition);
 		if(i<0) {
 			ERROR("ERROR checkMusicalTransposition: "
 				  "musical transposition command @K+ or @k+ needs integer "
@@ -890,7 +1521,7 @@ static int checkMusicalTransposition(const char *inMmlStr,int inStartPos,int inM
 	} else if(c=='-') {
 // Serial.printf("checkMusicalTransposition[-] - IN index=%d\n",inStartPos);
 		i=skipWhiteSpace(inMmlStr,i+1,inMmlLen);
-		i=checkInteger(inMmlStr,i,&musicalTransposition);
+		i=checkInteger(inMmlStr,i,inMmlLen,&musicalTransposition);
 		if(i<0) {
 			ERROR("ERROR checkMusicalTransposition: "
 				  "musical transposition command @K- or @k- needs integer "
@@ -930,15 +1561,15 @@ static int checkBaseStrength(const char *inMmlStr,int inStartPos,int inMmlLen,
 	int i=inStartPos;
 	int baseStrength;
 	i=skipWhiteSpace(inMmlStr,i,inMmlLen);
-	if(inMmlStr[i]==':') { i=skipWhiteSpace(inMmlStr,i+1,inMmlLen); }
-	i=checkInteger(inMmlStr,i,&baseStrength);
+	if(getMmlChar(inMmlStr,i,inMmlLen)==':') { i=skipWhiteSpace(inMmlStr,i+1,inMmlLen); }
+	i=checkInteger(inMmlStr,i,inMmlLen,&baseStrength);
 	if(i<0) {
 		ERROR("ERROR checkBaseStrength: "
 			  "base strength command V,v or @V or @V needs integer value."
 			  "(MML index=%d).\n",inStartPos);
 		return -1;
 	}
-	if(baseStrength>128) { baseStrength=127; }
+	if(baseStrength>127) { baseStrength=127; }
 	if(outBaseStrength!=NULL) { *outBaseStrength=baseStrength; }
 	return i;
 }
@@ -987,7 +1618,7 @@ static int getNoteOffset(char c,int inMusicalTransposition) {
 		case 'g':
 			return 7+gMusicalTranspositionOffset[t][6];
 		default:
-#ifdef TEST_ON_PC
+#ifdef MML_TRACE
 	printf("!!!!! SYSTEM ERROR !!!!!\n");
 #endif
 			return -1;
@@ -999,7 +1630,7 @@ static int checkNoteLength(const char *inMmlString,int inStartPos,int inMmlLengt
 	Rational noteLength=MakeRational(0,1);	// =0=0/1
 
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	char c=inMmlString[i];
+	char c=getMmlChar(inMmlString,i,inMmlLength);
 	if(c!='.' && c!='_' && c!='/' && c!='*' && (c<'0' || '9'<c)) {
 		if(outNoteLength!=NULL) { *outNoteLength=inDefaultNoteLength; }
 		return i;
@@ -1014,14 +1645,14 @@ static int checkNoteLength(const char *inMmlString,int inStartPos,int inMmlLengt
 
 	for(;;) {
 		i=skipWhiteSpace(inMmlString,i,inMmlLength);
-		if(inMmlString[i]=='+') {
+		if(getMmlChar(inMmlString,i,inMmlLength)=='+') {
 			i++;
 			i=skipWhiteSpace(inMmlString,i,inMmlLength);
 			i=checkNoteLengthTerm(inMmlString,i,inMmlLength,
 								  &noteTermLength,inDefaultNoteLength);
 			if(i<0) { return -1; }
 			noteLength=add(noteLength,noteTermLength);
-		} else if(inMmlString[i]=='-') {
+		} else if(getMmlChar(inMmlString,i,inMmlLength)=='-') {
 			i++;
 			i=skipWhiteSpace(inMmlString,i,inMmlLength);
 			i=checkNoteLengthTerm(inMmlString,i,inMmlLength,
@@ -1038,7 +1669,7 @@ static int checkNoteLengthTerm(const char *inMmlString,int inStartPos,int inMmlL
 						   	   Rational *outNoteLength,Rational inDefaultNoteLength) {
 	int i=inStartPos;
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	char c=inMmlString[i];
+	char c=getMmlChar(inMmlString,i,inMmlLength);
 	Rational noteLength;
 	if(c<'0' || '9'<c) {
 		noteLength=inDefaultNoteLength;
@@ -1048,7 +1679,7 @@ static int checkNoteLengthTerm(const char *inMmlString,int inStartPos,int inMmlL
 		if(i<0) { return -1; }
 	}
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	c=inMmlString[i];
+	c=getMmlChar(inMmlString,i,inMmlLength);
 	if(c!='.' && c!='/' && c!='_') {
 		if(outNoteLength!=NULL) { *outNoteLength=noteLength; }
 		return i;
@@ -1065,25 +1696,25 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 								 Rational *outNoteLengthNumberValue,
 								 Rational inDefaultNoteLength) {
 	int i=inStartPos;
-	char c=inMmlString[i];
+	char c=getMmlChar(inMmlString,i,inMmlLength);
 	Rational lengthNumber;
 	switch(c) {
 		case '1':	// 1 or 16 or 12
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,1);
 				i++;
 				goto leave;
 			} else if(c=='6') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,16);	// == 1/16
 				i++;
 				goto leave;
 			} else if(c=='2') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,12);
 				i++;
@@ -1093,14 +1724,14 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '2':	// 2 or 24
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,2);
 				i++;
 				goto leave;
 			} else if(c=='4') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,24);
 				i++;
@@ -1110,14 +1741,14 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '3':	// 3 or 32
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,3);
 				i++;
 				goto leave;
 			} else if(c=='2') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,32);
 				i++;
@@ -1127,14 +1758,14 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '4':	// 4 or 48
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,4);
 				i++;
 				goto leave;
 			} else if(c=='8') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,48);
 				i++;
@@ -1144,14 +1775,14 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '6':	// 6 or 64
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,6);
 				i++;
 				goto leave;
 			} else if(c=='4') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,64);
 				i++;
@@ -1161,7 +1792,7 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '8':	// only 8
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,8);
 				i++;
@@ -1171,14 +1802,14 @@ static int checkNoteLengthNumber(const char *inMmlString,int inStartPos,int inMm
 			}
 			break;
 		case '9':	// 9 or 96
-			c=inMmlString[i+1];
+			c=getMmlChar(inMmlString,i+1,inMmlLength);
 			if(c<'0' || '9'<c) {
 				lengthNumber=MakeRational(1,9);
 				i++;
 				goto leave;
 			} else if(c=='6') {
 				i++;
-				c=inMmlString[i+1];
+				c=getMmlChar(inMmlString,i+1,inMmlLength);
 				if('0'<=c && c<='9') { goto onError; }
 				lengthNumber=MakeRational(1,96);
 				i++;
@@ -1209,10 +1840,10 @@ static int checkNoteLengthModifierFactor(const char *inMmlString,int inStartPos,
 	Rational factor=MakeRational(1,1);
 
 	for(;;) {
-	   	c=inMmlString[i];
+	   	c=getMmlChar(inMmlString,i,inMmlLength);
 		if(c=='.') {
 			i++;
-			c=inMmlString[i];
+			c=getMmlChar(inMmlString,i,inMmlLength);
 			if(c!='.') {
 				factor=mul(factor,MakeRational(3,2));
 				goto leave;
@@ -1222,15 +1853,15 @@ static int checkNoteLengthModifierFactor(const char *inMmlString,int inStartPos,
 				factor=mul(factor,MakeRational(7,4));
 			}
 		} else if(c=='_') {
-			int n;
-			for(n=1; inMmlString[i]=='_'; i++,n*=2) {
-				// empty;
+			int n,k;
+			for(n=1,k=0; getMmlChar(inMmlString,i,inMmlLength)=='_'; i++,n*=2,k++) {
+				if(k>=kMaxMmlLengthModifiers) { goto onError; }
 			}
 			factor=mul(factor,MakeRational(n,1));
 		} else if(c=='/') {
-			int d;
-			for(d=1; inMmlString[i]=='/'; i++,d*=2) {
-				// empty;
+			int d,k;
+			for(d=1,k=0; getMmlChar(inMmlString,i,inMmlLength)=='/'; i++,d*=2,k++) {
+				if(k>=kMaxMmlLengthModifiers) { goto onError; }
 			}
 			factor=mul(factor,MakeRational(1,d));
 		} else {
@@ -1242,34 +1873,39 @@ leave:
 		*outNoteLengthFactor=factor;
 	}
 	return i;
+
+onError:
+	ERROR("MML ERROR: too many note length modifiers (around index=%d).\n",i);
+	printMmlErrorInfo(inMmlString,i,inMmlLength);
+	return -1;
 }
 static int checkNoteStrength(const char *inMmlString,int inStartPos,int inMmlLength,
 							 int *outStrength,int inBaseStrength) {
 	int strength=inBaseStrength;
 	int i=inStartPos;
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	char c=inMmlString[i];
+	char c=getMmlChar(inMmlString,i,inMmlLength);
 	if(c=='+') {
 		i++;
 		int delta;
-		i=checkInteger(inMmlString,i,&delta);
+		i=checkInteger(inMmlString,i,inMmlLength,&delta);
 		if(i<0) { return -1; }
 		strength+=delta;
 	} else if(c=='-') {
 		i++;
 		int delta;
-		i=checkInteger(inMmlString,i,&delta);
+		i=checkInteger(inMmlString,i,inMmlLength,&delta);
 		if(i<0) { return -1; }
 		strength-=delta;
 	} else {
-		c=inMmlString[i];
+		c=getMmlChar(inMmlString,i,inMmlLength);
 		if('0'<=c && c<='9') {
-			i=checkInteger(inMmlString,i,&strength);
+			i=checkInteger(inMmlString,i,inMmlLength,&strength);
 			if(i<0) { return -1; }
 		}
 	}
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	if(inMmlString[i]=='\'') {
+	if(getMmlChar(inMmlString,i,inMmlLength)=='\'') {
 		strength+=20;
 		i++;
 	}
@@ -1282,7 +1918,7 @@ static int checkOctaveCommand(const char *inMmlString,int inStartPos,int inMmlLe
 	int i=inStartPos;
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
 	int octaveNumber;
-	i=checkInteger(inMmlString,i,&octaveNumber);
+	i=checkInteger(inMmlString,i,inMmlLength,&octaveNumber);
 	if(i<0) {
 		ERROR("ERROR checkOctaveCommand: octave command 'O' or 'o' "
 			  "should have integer value. "
@@ -1304,11 +1940,16 @@ static int checkTempoValue(const char *inMmlString,int inStartPos,int inMmlLengt
 	i=checkRational(inMmlString,i,inMmlLength,&rational);
 	float tempoNumber;
 	if(i<0) {
-		i=checkNumber(inMmlString,startPos,&tempoNumber);
+		i=checkNumber(inMmlString,startPos,inMmlLength,&tempoNumber);
 		if(i<0) { return -1; }
 	} else {
 		tempoNumber=getRationalValue(rational);
 	}
+	if((tempoNumber>0)==false) {	// zero, minus or NaN (x/0)
+		ERROR("MML ERROR: tempo should be greater than 0 (index=%d).\n",startPos);
+		printMmlErrorInfo(inMmlString,startPos,inMmlLength);
+		return -1;
+	}
 	if(outTempoValue!=NULL) { *outTempoValue=tempoNumber; }
 	return i;
 }
@@ -1317,29 +1958,30 @@ static int checkRational(const char *inMmlString,int inStartPos,int inMmlLength,
 						 Rational *outRational) {
 	int i=inStartPos;
 	int numerator;
-	i=checkInteger(inMmlString,i,&numerator);
+	i=checkInteger(inMmlString,i,inMmlLength,&numerator);
 	if(i<0) { return -1; }
 	i=skipWhiteSpace(inMmlString,i,inMmlLength);
-	if(inMmlString[i]!='/') { return -1; }
+	if(getMmlChar(inMmlString,i,inMmlLength)!='/') { return -1; }
 	i=skipWhiteSpace(inMmlString,i+1,inMmlLength);
 	int denominator;
-	i=checkInteger(inMmlString,i,&denominator);
+	i=checkInteger(inMmlString,i,inMmlLength,&denominator);
 	if(i<0) { return -1; }
 	if(outRational!=NULL) { *outRational=MakeRational(numerator,denominator); }
 	return i;
 }
-static int checkNumber(const char *inMmlString,int inStartPos,float *outNumber) {
+static int checkNumber(const char *inMmlString,int inStartPos,int inMmlLength,
+					   float *outNumber) {
 	int i=inStartPos;
 	float number=0;
 	char c;
 	for(;; i++,number=number*10+c-'0') {
-		c=inMmlString[i];
+		c=getMmlChar(inMmlString,i,inMmlLength);
 		if(c<'0' || '9'<c) { break; }
 	}
 	if(c=='.') {
 		float s=1.0f;
 		for(i++; ; i++,number+=(c-'0')*s) {
-			c=inMmlString[i];
+			c=getMmlChar(inMmlString,i,inMmlLength);
 			if(c<'0' || '9'<c) { break; }
 			s*=0.1f;
 		}
@@ -1347,17 +1989,61 @@ static int checkNumber(const char *inMmlString,int inStartPos,float *outNumber)
 	if(outNumber!=NULL) { *outNumber=number; }
 	return i;
 }
-static int checkInteger(const char *inMmlString,int inStartPos,int *outIntValue) {
+static int checkInteger(const char *inMmlString,int inStartPos,int inMmlLength,
+						int *outIntValue) {
 	int i=inStartPos;
 	int number=0;
 	char c;
 	for(;; i++,number=number*10+c-'0') {
-		c=inMmlString[i];
+		c=getMmlChar(inMmlString,i,inMmlLength);
 		if(c<'0' || '9'<c) { break; }
+		if(number*10+(c-'0')>kMaxMmlInteger) {
+			ERROR("MML ERROR: too large integer (index=%d).\n",inStartPos);
+			printMmlErrorInfo(inMmlString,inStartPos,inMmlLength);
+			return -1;
+		}
 	}
 	if(outIntValue!=NULL) { *outIntValue=number; }
 	return i;
 }
+// effect-params : '=' | INTEGER (white-space* ',' white-space* INTEGER)* ;
+// '=' sets 0 to outValues[0]. omitted values are not changed.
+static int checkEffectParams(const char *inMmlString,int inStartPos,int inMmlLength,
+							 int *outValues,int inMaxValues,int *outNumOfValues) {
+	int i=skipWhiteSpace(inMmlString,inStartPos,inMmlLength);
+	if(getMmlChar(inMmlString,i,inMmlLength)=='=') {
+		outValues[0]=0;
+		*outNumOfValues=1;
+		return i+1;
+	}
+	int n=0;
+	for(;;) {
+		i=checkInteger(inMmlString,i,inMmlLength,outValues+n);
+		if(i<0) { return -1; }
+		n++;
+		int t=skipWhiteSpace(inMmlString,i,inMmlLength);
+		if(n>=inMaxValues || getMmlChar(inMmlString,t,inMmlLength)!=',') { break; }
+		i=skipWhiteSpace(inMmlString,t+1,inMmlLength);
+	}
+	*outNumOfValues=n;
+	return i;
+}
+// durations are sent to t2kSCore as int16_t [msec].
+static int16_t toDurationMSec(float inDurationMSec) {
+	if((inDurationMSec>0)==false) { return 0; }	// minus or NaN
+	if(inDurationMSec>INT16_MAX) { return INT16_MAX; }
+	return (int16_t)inDurationMSec;
+}
+static uint8_t toVolume(int inStrength) {
+	if(inStrength<0) { inStrength=0; }
+	if(inStrength>127) { inStrength=127; }
+	return (uint8_t)(inStrength/127.0*255);
+}
+// inMmlString[inMmlLength] or later are never touched, the parser reads '\0'
+// instead of them. so the MML need not to be null-terminated.
+static char getMmlChar(const char *inMmlString,int inIndex,int inMmlLength) {
+	return inIndex<inMmlLength ? inMmlString[inIndex] : '\0';
+}
 static bool isWhiteSpace(const char inChar) {
 	return inChar==' ' || inChar=='\t' || inChar=='\n' || inChar=='\r';
 }
@@ -1378,7 +2064,8 @@ static bool isMmlCommand(char inChar) {
 		|| inChar=='|'	// separate
 		|| inChar=='!'	// callback
 		|| inChar=='&' 	// ignore
-		|| inChar=='$';	// repeat mark
+		|| inChar=='$'	// repeat mark
+		|| inChar=='[' || inChar==']';	// loop
 }
 static int skipWhiteSpace(const char *inMmlString,int inStartPos,int inMmlLength) {
 	int i;
@@ -1392,11 +2079,11 @@ static void printMmlErrorInfo(const char *inMmlStr,int inIndex,int inMmlLen) {
 	for(int t=inIndex-5; t<inIndex+5; t++) {
 		if(t<0 || t>=inMmlLen) { continue; }
 		if(t==inIndex) {
-			Serial.printf("[%c]",inMmlStr[t]);
+			ERROR("[%c]",inMmlStr[t]);
 		} else {
-			Serial.printf("%c",inMmlStr[t]);
+			ERROR("%c",inMmlStr[t]);
 		}
 	}
-	Serial.printf("\n");
+	ERROR("\n");
 }
 
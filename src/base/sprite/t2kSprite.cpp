@@ -34,6 +34,38 @@ static uint8_t gGlobal16colorPalette[16]={
 	RGB(7,7,0),	// 14: 'Y' yellow
 	RGB(7,7,3),	// 15: 'W' white
 };
+// the palette of the 256 colors sprites (filled by t2kInit256colorSprite).
+// putSprite copies the pixels directly if the sprite is drawn with this palette.
+static uint8_t gIdentityPalette[256];
+
+// sprite arena (see t2kSpriteArenaInit). every block is aligned for the
+// word-wide blits (and for the uint32_t collision masks).
+const uint32_t kSpriteArenaAlign=4;
+static uint8_t *gSpriteArena=NULL;			// aligned start
+static uint8_t *gSpriteArenaBase=NULL;		// given or malloced area
+static bool gSpriteArena_needToFree=false;
+static uint32_t gSpriteArenaSize=0;
+static uint32_t gSpriteArenaUsed=0;
+static uint32_t gSpriteArenaHighWaterMark=0;
+
+static bool initSpriteHeader(T2K_Sprite16colors *outSprite,uint8_t inSpriteType,
+							 int inWidth,int inHeight,
+							 int8_t inOriginX,int8_t inOriginY,
+							 bool inUsePalette,uint8_t *inPaletteArea);
+static int toColorIndex(char inColorCommand);
+static void setIdentityPalette(T2K_Sprite16colors *outSprite);
+static void putPackedSprite(const T2K_Sprite16colors *inSprite,const uint8_t *inPalette,
+							int inStartU,int inEndU,int inStartV,int inEndV,
+							int inStartS,int inStartT);
+static void putCompiledSprite(const T2K_Sprite16colors *inSprite,const uint8_t *inPalette,
+							  int inLeft,int inStartV,int inEndV,int inStartT);
+static int getIndexColor(const T2K_Sprite16colors *inSprite,int inU,int inV);
+static void *allocSpriteMemory(int inSize,bool *outNeedToFree);
+static bool putSprite(const T2K_Sprite16colors *inSprite,int inFrame,const uint8_t *inPalette,
+					  int inLeft,int inTop,int inRight,int inBottom);
+static void put256colorSprite(const T2K_Sprite16colors *inSprite,
+							  int inStartU,int inEndU,int inStartV,int inEndV,
+							  int inStartS,int inStartT);
 
 bool t2kInitSprite(T2K_Sprite16colors *outSprite,
 				   int inWidth,int inHeight,
@@ -41,7 +73,255 @@ bool t2kInitSprite(T2K_Sprite16colors *outSprite,
 				   int8_t inOriginX,int8_t inOriginY,
 				   bool inUsePalette,uint8_t *inPaletteArea,
 				   uint8_t *inBitmapArea) {
-	outSprite->spriteInfo.spriteType=kST_16colors;
+	if(initSpriteHeader(outSprite,kST_16colors,inWidth,inHeight,inOriginX,inOriginY,
+						inUsePalette,inPaletteArea)==false) {
+		return false;
+	}
+	uint8_t *bitmap=inBitmapArea;
+	if(inBitmapArea==NULL) {
+		bitmap=(uint8_t *)allocSpriteMemory(sizeof(uint8_t)*inWidth*inHeight,
+											&outSprite->spriteInfo.bitmap_needToFree);
+		if(bitmap==NULL) {
+			ERROR("ERROR t2kInitSprite(T2K_Sprite16colors): "
+				  "not enough memory for bitmap area.\n");
+			return false;
+		}
+	}
+	outSprite->bitmap=bitmap;
+
+	uint8_t *dest=bitmap;
+	for(int y=0; y<inHeight; y++,dest+=inWidth) {
+		const char *s=inPatternStrArray[y];
+		for(int x=0; x<inWidth; x++) {
+			int t=toColorIndex(s[x]);
+			if(t<0) {
+				ERROR("ERROR t2kInitSprit(T2K_Sprite16colors): "
+					  "invalid color command '%c' at (%d,%d).\n",s[x],x,y);
+				return false;
+			}
+			dest[x]=t;
+			if(t==outSprite->spriteInfo.transparentColor) {
+				outSprite->spriteInfo.isOpaque=false;
+			}
+		}
+	}
+	return true;
+}
+
+// same as t2kInitSprite, but the bitmap is packed in 4 bits per pixel.
+// (the high nibble is the left pixel. a row is (inWidth+1)/2 bytes.)
+// inBitmapArea should have (inWidth+1)/2*inHeight bytes.
+bool t2kInitPackedSprite(T2K_Sprite16colors *outSprite,
+						 int inWidth,int inHeight,
+						 const char *inPatternStrArray[],
+						 int8_t inOriginX,int8_t inOriginY,
+						 bool inUsePalette,uint8_t *inPaletteArea,
+						 uint8_t *inBitmapArea) {
+	if(initSpriteHeader(outSprite,kST_16colors_Packed,inWidth,inHeight,inOriginX,inOriginY,
+						inUsePalette,inPaletteArea)==false) {
+		return false;
+	}
+	const int bytesPerRow=(inWidth+1)/2;
+	uint8_t *bitmap=inBitmapArea;
+	if(inBitmapArea==NULL) {
+		bitmap=(uint8_t *)allocSpriteMemory(sizeof(uint8_t)*bytesPerRow*inHeight,
+											&outSprite->spriteInfo.bitmap_needToFree);
+		if(bitmap==NULL) {
+			ERROR("ERROR t2kInitPackedSprite: not enough memory for bitmap area.\n");
+			return false;
+		}
+	}
+	outSprite->bitmap=bitmap;
+
+	// all index colors are validated here, so the blitter does not check them.
+	uint8_t *dest=bitmap;
+	for(int y=0; y<inHeight; y++,dest+=bytesPerRow) {
+		const char *s=inPatternStrArray[y];
+		memset(dest,0,bytesPerRow);		// padding is transparent.
+		for(int x=0; x<inWidth; x++) {
+			int t=toColorIndex(s[x]);
+			if(t<0) {
+				ERROR("ERROR t2kInitPackedSprite: "
+					  "invalid color command '%c' at (%d,%d).\n",s[x],x,y);
+				return false;
+			}
+			dest[x/2] |= (x & 1)==0 ? t<<4 : t;
+			if(t==outSprite->spriteInfo.transparentColor) {
+				outSprite->spriteInfo.isOpaque=false;
+			}
+		}
+	}
+	return true;
+}
+
+// inPixels has inWidth*inHeight RGB332 colors. they are copied into the bitmap
+// (inBitmapArea or malloc) unless inBitmapArea is inPixels.
+bool t2kInit256colorSprite(T2K_Sprite16colors *outSprite,int inWidth,int inHeight,
+						   const uint8_t *inPixels,
+						   int8_t inOriginX,int8_t inOriginY,
+						   int16_t inTransparentColor,uint8_t *inBitmapArea) {
+	if(inTransparentColor<-1 || 255<inTransparentColor) {
+		ERROR("ERROR t2kInit256colorSprite: invalid transparent color %d.\n",
+			  inTransparentColor);
+		return false;
+	}
+	if(initSpriteHeader(outSprite,kST_256colors,inWidth,inHeight,inOriginX,inOriginY,
+						false,NULL)==false) {
+		return false;
+	}
+	setIdentityPalette(outSprite);
+	outSprite->spriteInfo.transparentColor=inTransparentColor;
+
+	uint8_t *bitmap=inBitmapArea;
+	if(inBitmapArea==NULL) {
+		bitmap=(uint8_t *)allocSpriteMemory(sizeof(uint8_t)*inWidth*inHeight,
+											&outSprite->spriteInfo.bitmap_needToFree);
+		if(bitmap==NULL) {
+			ERROR("ERROR t2kInit256colorSprite: not enough memory for bitmap area.\n");
+			return false;
+		}
+	}
+	if(bitmap!=inPixels) {
+		memcpy(bitmap,inPixels,inWidth*inHeight);
+	}
+	outSprite->bitmap=bitmap;
+	if(inTransparentColor>=0) {
+		outSprite->spriteInfo.isOpaque
+			= memchr(outSprite->bitmap,inTransparentColor,inWidth*inHeight)==NULL;
+	}
+	return true;
+}
+
+// the palette and the bitmap are never written by t2k,
+// so they can be const arrays in flash.
+bool t2kInitSpriteFromROM(T2K_Sprite16colors *outSprite,const T2K_SpriteROM *inROM) {
+	if(inROM->spriteType!=kST_16colors && inROM->spriteType!=kST_16colors_Packed
+	   && inROM->spriteType!=kST_256colors) {
+		ERROR("ERROR t2kInitSpriteFromROM: invalid sprite type %d.\n",inROM->spriteType);
+		return false;
+	}
+	if(inROM->bitmap==NULL || inROM->width==0 || inROM->height==0
+	   || inROM->numOfFrames==0) {
+		ERROR("ERROR t2kInitSpriteFromROM: invalid sprite data.\n");
+		return false;
+	}
+	if(initSpriteHeader(outSprite,inROM->spriteType,inROM->width,inROM->height,
+						inROM->centerX,inROM->centerY,false,NULL)==false) {
+		return false;
+	}
+	outSprite->spriteInfo.numOfFrames=inROM->numOfFrames;
+	outSprite->spriteInfo.transparentColor=inROM->transparentColor;
+	outSprite->spriteInfo.isOpaque=inROM->isOpaque;
+	outSprite->bitmap=inROM->bitmap;
+	outSprite->spans=inROM->spans;
+	outSprite->mask=inROM->mask;
+	if(inROM->spriteType==kST_256colors) {
+		setIdentityPalette(outSprite);
+	} else if(inROM->palette!=NULL) {
+		outSprite->palette=(uint8_t *)inROM->palette;	// read only
+	}
+	return true;
+}
+
+// frames are stacked vertically in inPatternStrArray (and in the bitmap),
+// so inPatternStrArray has inHeight*inNumOfFrames rows.
+// the frames can be shared by many instances (see T2K_SpriteAnimator).
+bool t2kInitSpriteSheet(T2K_Sprite16colors *outSprite,
+						int inWidth,int inHeight,int inNumOfFrames,
+						const char *inPatternStrArray[],
+						int8_t inOriginX,int8_t inOriginY,
+						bool inUsePalette,uint8_t *inPaletteArea,
+						uint8_t *inBitmapArea,bool inIsPacked) {
+	if(inNumOfFrames<1 || 255<inNumOfFrames) {
+		ERROR("ERROR t2kInitSpriteSheet: invalid num of frames (%d).\n",inNumOfFrames);
+		return false;
+	}
+	bool result;
+	if( inIsPacked ) {
+		result=t2kInitPackedSprite(outSprite,inWidth,inHeight*inNumOfFrames,inPatternStrArray,
+								   inOriginX,inOriginY,inUsePalette,inPaletteArea,inBitmapArea);
+	} else {
+		result=t2kInitSprite(outSprite,inWidth,inHeight*inNumOfFrames,inPatternStrArray,
+							 inOriginX,inOriginY,inUsePalette,inPaletteArea,inBitmapArea);
+	}
+	if(result==false) { return false; }
+	outSprite->spriteInfo.height=inHeight;
+	outSprite->spriteInfo.numOfFrames=inNumOfFrames;
+	return true;
+}
+
+// free the areas made by malloc. the areas in the arena are freed by
+// t2kSpriteArenaRelease, and the areas given by the caller are not touched.
+void t2kFreeSprite(T2K_Sprite16colors *ioSprite) {
+	if(ioSprite->spriteInfo.bitmap_needToFree)	{ free((void *)ioSprite->bitmap); }
+	if(ioSprite->spriteInfo.palette_needToFree)	{ free(ioSprite->palette); }
+	if(ioSprite->spriteInfo.spans_needToFree)	{ free((void *)ioSprite->spans); }
+	if(ioSprite->spriteInfo.mask_needToFree)	{ free((void *)ioSprite->mask); }
+	ioSprite->spriteInfo.spriteType=kST_Invalid;
+	ioSprite->spriteInfo.bitmap_needToFree=false;
+	ioSprite->spriteInfo.palette_needToFree=false;
+	ioSprite->spriteInfo.spans_needToFree=false;
+	ioSprite->spriteInfo.mask_needToFree=false;
+	ioSprite->bitmap=NULL;
+	ioSprite->palette=NULL;
+	ioSprite->spans=NULL;
+	ioSprite->mask=NULL;
+}
+
+// ============================== arena ==============================
+// inArea==NULL means the arena is made by malloc (once, at boot is best).
+// inSize==0 stops the arena, and the sprites are made by malloc again.
+bool t2kSpriteArenaInit(uint32_t inSize,uint8_t *inArea) {
+	if(gSpriteArena_needToFree) { free(gSpriteArenaBase); }
+	gSpriteArenaBase=NULL;
+	gSpriteArena=NULL;
+	gSpriteArena_needToFree=false;
+	gSpriteArenaSize=0;
+	gSpriteArenaUsed=0;
+	gSpriteArenaHighWaterMark=0;
+	if(inSize==0) { return true; }
+	uint8_t *area=inArea;
+	if(inArea==NULL) {
+		area=(uint8_t *)malloc(inSize);
+		if(area==NULL) {
+			ERROR("ERROR t2kSpriteArenaInit: not enough memory for %u bytes.\n",
+				  (unsigned)inSize);
+			return false;
+		}
+		gSpriteArena_needToFree=true;
+	}
+	// the start is aligned, so the offsets keep the alignment.
+	const uint32_t pad=(kSpriteArenaAlign-(uintptr_t)area%kSpriteArenaAlign)%kSpriteArenaAlign;
+	if(inSize<=pad) {
+		ERROR("ERROR t2kSpriteArenaInit: too small arena.\n");
+		if(gSpriteArena_needToFree) { free(area); }
+		gSpriteArena_needToFree=false;
+		return false;
+	}
+	gSpriteArenaBase=area;
+	gSpriteArena=area+pad;
+	gSpriteArenaSize=inSize-pad;
+	return true;
+}
+uint32_t t2kSpriteArenaMark() {
+	return gSpriteArenaUsed;
+}
+// all sprites made after inMark are invalid after this call.
+void t2kSpriteArenaRelease(uint32_t inMark) {
+	if(inMark<gSpriteArenaUsed) { gSpriteArenaUsed=inMark; }
+}
+uint32_t t2kSpriteArenaUsed() {
+	return gSpriteArenaUsed;
+}
+uint32_t t2kSpriteArenaHighWaterMark() {
+	return gSpriteArenaHighWaterMark;
+}
+
+static bool initSpriteHeader(T2K_Sprite16colors *outSprite,uint8_t inSpriteType,
+							 int inWidth,int inHeight,
+							 int8_t inOriginX,int8_t inOriginY,
+							 bool inUsePalette,uint8_t *inPaletteArea) {
+	outSprite->spriteInfo.spriteType=inSpriteType;
 	outSprite->spriteInfo.width =inWidth;
 	outSprite->spriteInfo.height=inHeight;
 	outSprite->spriteInfo.numOfFrames=1;
@@ -49,70 +329,89 @@ bool t2kInitSprite(T2K_Sprite16colors *outSprite,
 	outSprite->spriteInfo.centerY=inOriginY;
 	outSprite->spriteInfo.numOfColors=16;
 	outSprite->spriteInfo.transparentColor=0;
+	outSprite->spriteInfo.isOpaque=true;	// cleared while decoding the pattern.
+	outSprite->spriteInfo.bitmap_needToFree=false;
+	outSprite->spriteInfo.palette_needToFree=false;
+	outSprite->spriteInfo.spans_needToFree=false;
+	outSprite->spriteInfo.mask_needToFree=false;
+	outSprite->bitmap=NULL;
+	outSprite->spans=NULL;
+	outSprite->mask=NULL;
 	if( inUsePalette ) {
 	   	if(inPaletteArea==NULL) {
-			outSprite->palette=(uint8_t *)malloc(sizeof(uint8_t)*16);
+			outSprite->palette=(uint8_t *)allocSpriteMemory(sizeof(uint8_t)*16,
+										&outSprite->spriteInfo.palette_needToFree);
 			if(outSprite->palette==NULL) {
 				ERROR("ERROR t2kInitSprite(T2K_Sprite16colors): "
 					  "not enough memory for palette area.\n");
 				return false;
 			}
-			outSprite->spriteInfo.palette_needToFree=true;
 		} else {
 			outSprite->palette=inPaletteArea;
-			outSprite->spriteInfo.palette_needToFree=false;
 		}
 	} else {
 		outSprite->palette=gGlobal16colorPalette;
-		outSprite->spriteInfo.palette_needToFree=false;
 	}
-	if(inBitmapArea==NULL) {
-		outSprite->bitmap=(uint8_t *)malloc(sizeof(uint8_t)*inWidth*inHeight);
-		if(outSprite->bitmap==NULL) {
-			ERROR("ERROR t2kInitSprite(T2K_Sprite16colors): "
-				  "not enough memory for bitmap area.\n");
-			return false;
-		}
-		outSprite->spriteInfo.palette_needToFree=true;
+	return true;
+}
+// from the arena if it exists (never freed one by one), or from malloc.
+static void *allocSpriteMemory(int inSize,bool *outNeedToFree) {
+	if(gSpriteArena==NULL) {
+		void *p=malloc(inSize);
+		*outNeedToFree = p!=NULL;
+		return p;
 	}
-
-	uint8_t *dest=outSprite->bitmap;
-	const char *s=inPatternStrArray[0];
-	uint8_t t;
-	for(int y=0; y<inHeight; y++,dest+=inWidth,s=inPatternStrArray[y]) {
-		for(int x=0; x<inWidth; x++) {
-			switch(s[x]) {
-				case '_': t= 0; break;
-				case 'b': t= 1; break;
-				case 'r': t= 2; break;
-				case 'm': t= 3; break;
-				case 'g': t= 4; break;
-				case 'c': t= 5; break;
-				case 'y': t= 6; break;
-				case 'w': t= 7; break;
-				case 'k': t= 8; break;
-				case 'B': t= 9; break;
-				case 'R': t=10; break;
-				case 'M': t=11; break;
-				case 'G': t=12; break;
-				case 'C': t=13; break;
-				case 'Y': t=14; break;
-				case 'W': t=15; break;
-				default:
-					ERROR("ERROR t2kInitSprit(T2K_Sprite16colors): "
-						  "invalid color command '%c' at (%d,%d).\n",s[x],x,y);
-					return false;
-			}
-			dest[x]=t;
-		}
+	*outNeedToFree=false;
+	const uint32_t size=(inSize+kSpriteArenaAlign-1) & ~(kSpriteArenaAlign-1);
+	if(gSpriteArenaSize-gSpriteArenaUsed<size) {
+		ERROR("ERROR t2kSprite: the sprite arena is full (%u/%u bytes).\n",
+			  (unsigned)gSpriteArenaUsed,(unsigned)gSpriteArenaSize);
+		return NULL;
+	}
+	void *p=gSpriteArena+gSpriteArenaUsed;
+	gSpriteArenaUsed+=size;
+	if(gSpriteArenaUsed>gSpriteArenaHighWaterMark) {
+		gSpriteArenaHighWaterMark=gSpriteArenaUsed;
+	}
+	return p;
+}
+static void setIdentityPalette(T2K_Sprite16colors *outSprite) {
+	for(int i=0; i<256; i++) { gIdentityPalette[i]=i; }
+	outSprite->palette=gIdentityPalette;
+	outSprite->spriteInfo.numOfColors=256;
+}
+// return -1 if inColorCommand is invalid.
+static int toColorIndex(char inColorCommand) {
+	switch(inColorCommand) {
+		case '_': return  0;
+		case 'b': return  1;
+		case 'r': return  2;
+		case 'm': return  3;
+		case 'g': return  4;
+		case 'c': return  5;
+		case 'y': return  6;
+		case 'w': return  7;
+		case 'k': return  8;
+		case 'B': return  9;
+		case 'R': return 10;
+		case 'M': return 11;
+		case 'G': return 12;
+		case 'C': return 13;
+		case 'Y': return 14;
+		case 'W': return 15;
+		default:  return -1;
 	}
-	return true;
 }
 
 // draw it so that the center of the sprite (centerX,centerY) is at the position
 // of the screen (inX,inY).
 bool t2kPutSprite(T2K_Sprite16colors *inSprite,int inX,int inY,
 				  uint8_t *inCustomPalette) {
+	return t2kPutSpriteFrame(inSprite,0,inX,inY,inCustomPalette);
+}
+bool t2kPutSpriteFrame(T2K_Sprite16colors *inSprite,int inFrame,int inX,int inY,
+					   uint8_t *inCustomPalette) {
+	if(inFrame<0 || inSprite->spriteInfo.numOfFrames<=inFrame) { return false; }
 	if(inSprite->bitmap==NULL
 	   || (inSprite->palette==NULL && inCustomPalette==NULL)) {
 		// illegal sprite data.
@@ -123,44 +422,451 @@ bool t2kPutSprite(T2K_Sprite16colors *inSprite,int inX,int inY,
 								&left,&top,&right,&bottom)==false) {
 		return true;	// no pixels to draw.
 	}
+	return putSprite(inSprite,inFrame,
+					 inCustomPalette!=NULL ? inCustomPalette : inSprite->palette,
+					 left,top,right,bottom);
+}
+// draw the sprite flipped and/or rotated (see SpriteFlag).
+// the rotation is applied first, and the flips are applied to the rotated image.
+// the source bitmap is walked in the transformed order, so the same bitmap
+// (and the same frames) can be used for every direction.
+// the center of the sprite is transformed too, so (inX,inY) keeps to be the pivot.
+bool t2kPutSpriteEx(T2K_Sprite16colors *inSprite,int inX,int inY,uint8_t inFlags,
+					uint8_t *inCustomPalette,int inFrame) {
+	if(inFrame<0 || inSprite->spriteInfo.numOfFrames<=inFrame) { return false; }
+	if(inSprite->bitmap==NULL
+	   || (inSprite->palette==NULL && inCustomPalette==NULL)) {
+		// illegal sprite data.
+		return false;
+	}
+	const uint8_t *palette=inCustomPalette!=NULL ? inCustomPalette : inSprite->palette;
+	if((inFlags & (kSF_FlipH | kSF_FlipV | kSF_Rot90))==0) {
+		int left,top,right,bottom;
+		if(t2kSprite_HasVisibleArea(&inSprite->spriteInfo,inX,inY,
+									&left,&top,&right,&bottom)==false) {
+			return true;
+		}
+		return putSprite(inSprite,inFrame,palette,left,top,right,bottom);
+	}
+
+	const int w=inSprite->spriteInfo.width;
+	const int h=inSprite->spriteInfo.height;
+	const bool isRot90=(inFlags & kSF_Rot90)!=0;
+	// size of the transformed image.
+	const int dw = isRot90 ? h : w;
+	const int dh = isRot90 ? w : h;
+
+	// (u,v) in bitmap of (x,y) in the transformed image is
+	//	u = u0 + uX*x + uY*y
+	//	v = v0 + vX*x + vY*y
+	int u0=0,v0=0,uX=1,vX=0,uY=0,vY=1;
+	if( isRot90 ) {		// clockwise: (x,y) <- (u,v)=(y,h-1-x)
+		v0=h-1; uX=0; vX=-1; uY=1; vY=0;
+	}
+	if((inFlags & kSF_FlipH)!=0) {	// x -> dw-1-x
+		u0+=uX*(dw-1); v0+=vX*(dw-1); uX=-uX; vX=-vX;
+	}
+	if((inFlags & kSF_FlipV)!=0) {	// y -> dh-1-y
+		u0+=uY*(dh-1); v0+=vY*(dh-1); uY=-uY; vY=-vY;
+	}
+	// the matrix is a signed permutation, so the inverse is the transpose.
+	const int cu=inSprite->spriteInfo.centerX-u0;
+	const int cv=inSprite->spriteInfo.centerY-v0;
+	const int left=inX-(uX*cu+vX*cv);
+	const int top =inY-(uY*cu+vY*cv);
+	const int right =left+dw;
+	const int bottom=top +dh;
+	if(right<=0 || kGRamWidth<=left || bottom<=0 || kGRamHeight<=top) {
+		return true;	// no pixels to draw.
+	}
+
+	// same clipping as putSprite, in the transformed image.
+	// x in [startX,endX)
+	int startX = left<0 ? -left : 0;
+	int endX   = right>kGRamWidth ? dw-(right-kGRamWidth) : dw;
+	// y in [startY,endY)
+	int startY = top<0 ? -top : 0;
+	int endY   = bottom>kGRamHeight ? dh-(bottom-kGRamHeight) : dh;
+	int startS = left<0 ? 0 : left;
+	int startT = top <0 ? 0 : top;
+
+	// walk the bitmap by the pixel index n=v*stride+u.
+	// (for the packed sprite, n is the index of the nibble.)
+	const bool isPacked=inSprite->spriteInfo.spriteType==kST_16colors_Packed;
+	const int stride = isPacked ? (w+1)/2*2 : w;
+	const int stepX=vX*stride+uX;
+	const int stepY=vY*stride+uY;
+	const int transparentColorIndex=inSprite->spriteInfo.transparentColor;
+	const int numOfColors=inSprite->spriteInfo.numOfColors;
+	const uint8_t *bitmap=inSprite->bitmap+(isPacked ? stride/2 : stride)*inFrame*h;
+	int nScanline=(v0+vX*startX+vY*startY)*stride+u0+uX*startX+uY*startY;
+	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(startS,startT);
+	for(int y=startY; y<endY; y++,nScanline+=stepY,dstScanline+=kGRamWidth) {
+		int n=nScanline;
+		uint8_t *dst=dstScanline;
+		if( isPacked ) {
+			for(int x=startX; x<endX; x++,n+=stepX,dst++) {
+				const uint8_t pair=bitmap[n>>1];
+				uint8_t indexColor=(n & 1)==0 ? pair>>4 : pair & 0x0F;
+				if(indexColor!=transparentColorIndex) { *dst=palette[indexColor]; }
+			}
+		} else {
+			for(int x=startX; x<endX; x++,n+=stepX,dst++) {
+				uint8_t indexColor=bitmap[n];
+				if(indexColor>=numOfColors) {
+					// illegal index color
+					return false;
+				}
+				if(indexColor!=transparentColorIndex) { *dst=palette[indexColor]; }
+			}
+		}
+	}
+	return true;
+}
+// draw the sprite rotated by inAngle (radian, clockwise on the screen) and
+// scaled by inScale around its center (centerX,centerY), which is put at (inX,inY).
+// each pixel in the bounding box on the screen is mapped back into the bitmap
+// with 16.16 fixed point increments, so there are no holes at any angle.
+// (inAngle=0 and inScale=1 draws the same pixels as t2kPutSprite.)
+bool t2kPutSpriteAffine(T2K_Sprite16colors *inSprite,int inX,int inY,
+						float inAngle,float inScale,
+						uint8_t *inCustomPalette,int inFrame) {
+	if(inFrame<0 || inSprite->spriteInfo.numOfFrames<=inFrame) { return false; }
+	if(inSprite->bitmap==NULL
+	   || (inSprite->palette==NULL && inCustomPalette==NULL)) {
+		// illegal sprite data.
+		return false;
+	}
+	if(inScale<=0) { return false; }
+	const uint8_t *palette=inCustomPalette!=NULL ? inCustomPalette : inSprite->palette;
+	const int w=inSprite->spriteInfo.width;
+	const int h=inSprite->spriteInfo.height;
+	const float pivotU=inSprite->spriteInfo.centerX+0.5f;
+	const float pivotV=inSprite->spriteInfo.centerY+0.5f;
+	const float pivotX=inX+0.5f;
+	const float pivotY=inY+0.5f;
+	const float c=cosf(inAngle);
+	const float s=sinf(inAngle);
+
+	// bounding box of the transformed corners, clipped by the screen.
+	// (x,y) = (pivotX,pivotY) + scale*R(angle)*((u,v)-(pivotU,pivotV))
+	float minX=0,maxX=0,minY=0,maxY=0;
+	for(int i=0; i<4; i++) {
+		const float du=((i & 1)==0 ? 0 : w)-pivotU;
+		const float dv=((i & 2)==0 ? 0 : h)-pivotV;
+		const float x=pivotX+inScale*(c*du-s*dv);
+		const float y=pivotY+inScale*(s*du+c*dv);
+		if(i==0 || x<minX) { minX=x; }
+		if(i==0 || x>maxX) { maxX=x; }
+		if(i==0 || y<minY) { minY=y; }
+		if(i==0 || y>maxY) { maxY=y; }
+	}
+	const int startX = minX<0 ? 0 : (int)minX;
+	const int endX   = maxX>=kGRamWidth  ? kGRamWidth  : (int)maxX+1;
+	const int startY = minY<0 ? 0 : (int)minY;
+	const int endY   = maxY>=kGRamHeight ? kGRamHeight : (int)maxY+1;
+	if(startX>=endX || startY>=endY) { return true; }	// no pixels to draw.
+
+	// inverse mapping in 16.16 fixed point.
+	// (u,v) = (pivotU,pivotV) + R(-angle)/scale*((x,y)-(pivotX,pivotY))
+	const float k=65536.0f/inScale;
+	const int32_t duX=(int32_t)( c*k), dvX=(int32_t)(-s*k);
+	const int32_t duY=(int32_t)( s*k), dvY=(int32_t)( c*k);
+	const float x0=startX+0.5f-pivotX;
+	const float y0=startY+0.5f-pivotY;
+	int32_t uScanline=(int32_t)(pivotU*65536.0f+( c*x0+s*y0)*k);
+	int32_t vScanline=(int32_t)(pivotV*65536.0f+(-s*x0+c*y0)*k);
+
+	const bool isPacked=inSprite->spriteInfo.spriteType==kST_16colors_Packed;
+	const int bytesPerRow = isPacked ? (w+1)/2 : w;
+	const uint32_t limitU=(uint32_t)w<<16;
+	const uint32_t limitV=(uint32_t)h<<16;
+	const int transparentColorIndex=inSprite->spriteInfo.transparentColor;
+	const int numOfColors=inSprite->spriteInfo.numOfColors;
+	const uint8_t *bitmap=inSprite->bitmap+bytesPerRow*inFrame*h;
+	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(0,startY);
+	for(int y=startY; y<endY; y++,uScanline+=duY,vScanline+=dvY,dstScanline+=kGRamWidth) {
+		int32_t u=uScanline;
+		int32_t v=vScanline;
+		for(int x=startX; x<endX; x++,u+=duX,v+=dvX) {
+			// negative u or v is rejected by the unsigned compare.
+			if((uint32_t)u>=limitU || (uint32_t)v>=limitV) { continue; }
+			const uint8_t *src=bitmap+(v>>16)*bytesPerRow;
+			uint8_t indexColor;
+			if( isPacked ) {
+				const int iu=u>>16;
+				indexColor=(iu & 1)==0 ? src[iu>>1]>>4 : src[iu>>1] & 0x0F;
+			} else {
+				indexColor=src[u>>16];
+				if(indexColor>=numOfColors) {
+					// illegal index color
+					return false;
+				}
+			}
+			if(indexColor==transparentColorIndex) { continue; }
+			dstScanline[x]=palette[indexColor];
+		}
+	}
+	return true;
+}
+// the sprite area [inLeft,inRight)x[inTop,inBottom) should be visible.
+static bool putSprite(const T2K_Sprite16colors *inSprite,int inFrame,const uint8_t *inPalette,
+					  int inLeft,int inTop,int inRight,int inBottom) {
 	const int w=inSprite->spriteInfo.width;
 	const int h=inSprite->spriteInfo.height;
-	uint8_t *palette = inCustomPalette!=NULL ? inCustomPalette : inSprite->palette;
 	const int transparentColorIndex=inSprite->spriteInfo.transparentColor;
 
 	// NOTE: (u,v) in bitmap
 	// u in [startU,endU)
-	int startU = left<0 ? -left : 0;
-	int endU   = right>kGRamWidth ? w-(right-kGRamWidth) : w;
+	int startU = inLeft<0 ? -inLeft : 0;
+	int endU   = inRight>kGRamWidth ? w-(inRight-kGRamWidth) : w;
 	// v in [startV,endV)
-	int startV = top<0 ? -top : 0;
-	int endV   = bottom>kGRamHeight ? h-(bottom-kGRamHeight) : h;
+	int startV = inTop<0 ? -inTop : 0;
+	int endV   = inBottom>kGRamHeight ? h-(inBottom-kGRamHeight) : h;
 
 	// NOTE: (s,t) in GRAM
 	// s in [0,kGRamWidth)
-	int startS = left<0 ? 0 : left;
-	int endS   = kGRamWidth<right ? kGRamWidth : right;
+	int startS = inLeft<0 ? 0 : inLeft;
+	int endS   = kGRamWidth<inRight ? kGRamWidth : inRight;
 	// t in [0,kGRamHeight)
-	int startT = top<0 ? 0 : top;
-	int endT   = kGRamHeight<bottom ? kGRamHeight :  bottom;
+	int startT = inTop<0 ? 0 : inTop;
+	int endT   = kGRamHeight<inBottom ? kGRamHeight :  inBottom;
+
+	// frames are stacked vertically.
+	startV+=inFrame*h;
+	endV  +=inFrame*h;
+
+	if(inSprite->spans!=NULL) {
+		putCompiledSprite(inSprite,inPalette,inLeft,startV,endV,startT);
+		return true;
+	}
+	if(inSprite->spriteInfo.spriteType==kST_16colors_Packed) {
+		putPackedSprite(inSprite,inPalette,startU,endU,startV,endV,startS,startT);
+		return true;
+	}
+	if(inSprite->spriteInfo.spriteType==kST_256colors && inPalette==gIdentityPalette) {
+		put256colorSprite(inSprite,startU,endU,startV,endV,startS,startT);
+		return true;
+	}
 
-	uint8_t *srcScanline=inSprite->bitmap+startV*w+startU;
+	const int numOfColors=inSprite->spriteInfo.numOfColors;
+	const uint8_t *srcScanline=inSprite->bitmap+startV*w;
 	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(0,startT);
 	for(int t=startT,v=startV; v<endV && t<endT;
 			t++,v++,dstScanline+=kGRamWidth,srcScanline+=w) {
 		for(int s=startS,u=startU; u<endU && s<endS; s++,u++) {
 			uint8_t indexColor=srcScanline[u];
-			if(indexColor>=16) {
+			if(indexColor>=numOfColors) {
 				// illegal index color
 				return false;
 			}
 			if(indexColor==transparentColorIndex) { continue; }
-			dstScanline[s]=palette[indexColor];
+			dstScanline[s]=inPalette[indexColor];
 		}
 	}
 	return true;
 }
 
+// build the spans of opaque pixels for each row.
+// format:
+//	uint16_t rowOffset[height];		// offset of the row data from spans
+//	row data:
+//		uint8_t numOfSpans;
+//		numOfSpans x { uint8_t skip; uint8_t length; uint8_t indexColor[length]; }
+//		(skip is the num of transparent pixels after the previous span)
+// t2kPutSprite uses the spans instead of the bitmap if they exist.
+bool t2kCompileSprite(T2K_Sprite16colors *ioSprite) {
+	const int w=ioSprite->spriteInfo.width;
+	const int h=ioSprite->spriteInfo.height*ioSprite->spriteInfo.numOfFrames;	// all frames
+	const int transparentColorIndex=ioSprite->spriteInfo.transparentColor;
+	if(ioSprite->bitmap==NULL) { return false; }
+	if(ioSprite->spriteInfo.spriteType==kST_256colors) {
+		// the opaque runs are copied by words without spans.
+		ERROR("ERROR t2kCompileSprite: the 256 colors sprite can not be compiled.\n");
+		return false;
+	}
+
+	// pass 1: size of the spans
+	int size=sizeof(uint16_t)*h;
+	for(int v=0; v<h; v++) {
+		size++;		// numOfSpans
+		for(int u=0; u<w; u++) {
+			int indexColor=getIndexColor(ioSprite,u,v);
+			if(indexColor>=16) {
+				ERROR("ERROR t2kCompileSprite: invalid index color %d at (%d,%d).\n",
+					  indexColor,u,v);
+				return false;
+			}
+			if(indexColor==transparentColorIndex) { continue; }
+			if(u==0 || getIndexColor(ioSprite,u-1,v)==transparentColorIndex) {
+				size+=2;	// skip and length
+			}
+			size++;
+		}
+	}
+	if(size>UINT16_MAX) {
+		ERROR("ERROR t2kCompileSprite: too large sprite.\n");
+		return false;
+	}
+	bool needToFree;
+	uint8_t *spans=(uint8_t *)allocSpriteMemory(size,&needToFree);
+	if(spans==NULL) {
+		ERROR("ERROR t2kCompileSprite: not enough memory for spans.\n");
+		return false;
+	}
+	if(ioSprite->spriteInfo.spans_needToFree) { free((void *)ioSprite->spans); }
+	ioSprite->spriteInfo.spans_needToFree=needToFree;
+
+	// pass 2
+	uint16_t *rowOffset=(uint16_t *)spans;
+	uint8_t *p=spans+sizeof(uint16_t)*h;
+	for(int v=0; v<h; v++) {
+		rowOffset[v]=p-spans;
+		uint8_t *numOfSpans=p++;
+		*numOfSpans=0;
+		int prevEnd=0;
+		for(int u=0; u<w; ) {
+			if(getIndexColor(ioSprite,u,v)==transparentColorIndex) { u++; continue; }
+			uint8_t *length=p+1;
+			*p=u-prevEnd;
+			p+=2;
+			for(; u<w && getIndexColor(ioSprite,u,v)!=transparentColorIndex; u++) {
+				*p++=getIndexColor(ioSprite,u,v);
+			}
+			*length=p-(length+1);
+			prevEnd=u;
+			(*numOfSpans)++;
+		}
+	}
+	ioSprite->spans=spans;
+	return true;
+}
+// 1 bit per pixel (1 is opaque) for t2kHitTest, made only for the sprites
+// which need pixel perfect collision (the mask of a 8 pixels wide packed
+// sprite is as large as its bitmap).
+// each row is (width+31)/32 words, and the left pixel is the MSB.
+bool t2kBuildCollisionMask(T2K_Sprite16colors *ioSprite) {
+	if(ioSprite->bitmap==NULL) { return false; }
+	if(ioSprite->mask!=NULL) { return true; }	// already built (or in flash)
+	const int w=ioSprite->spriteInfo.width;
+	const int numOfRows=ioSprite->spriteInfo.height*ioSprite->spriteInfo.numOfFrames;
+	const int wordsPerRow=(w+31)/32;
+	const int transparentColorIndex=ioSprite->spriteInfo.transparentColor;
+	uint32_t *mask=(uint32_t *)allocSpriteMemory(sizeof(uint32_t)*wordsPerRow*numOfRows,
+												 &ioSprite->spriteInfo.mask_needToFree);
+	if(mask==NULL) {
+		ERROR("ERROR t2kBuildCollisionMask: not enough memory for collision mask.\n");
+		return false;
+	}
+	memset(mask,0,sizeof(uint32_t)*wordsPerRow*numOfRows);
+	uint32_t *row=mask;
+	for(int v=0; v<numOfRows; v++,row+=wordsPerRow) {
+		for(int u=0; u<w; u++) {
+			if(getIndexColor(ioSprite,u,v)!=transparentColorIndex) {
+				row[u>>5] |= 0x80000000u>>(u & 31);
+			}
+		}
+	}
+	ioSprite->mask=mask;
+	return true;
+}
+static int getIndexColor(const T2K_Sprite16colors *inSprite,int inU,int inV) {
+	const int w=inSprite->spriteInfo.width;
+	if(inSprite->spriteInfo.spriteType==kST_16colors_Packed) {
+		uint8_t pair=inSprite->bitmap[inV*((w+1)/2)+inU/2];
+		return (inU & 1)==0 ? pair>>4 : pair & 0x0F;
+	} else {
+		return inSprite->bitmap[inV*w+inU];
+	}
+}
+// draw rows v in [inStartV,inEndV) (clipped already). the spans are
+// clipped horizontally here, and transparent pixels are never visited.
+static void putCompiledSprite(const T2K_Sprite16colors *inSprite,const uint8_t *inPalette,
+							  int inLeft,int inStartV,int inEndV,int inStartT) {
+	const uint16_t *rowOffset=(const uint16_t *)inSprite->spans;
+	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(0,inStartT);
+	for(int v=inStartV; v<inEndV; v++,dstScanline+=kGRamWidth) {
+		const uint8_t *p=inSprite->spans+rowOffset[v];
+		int numOfSpans=*p++;
+		int x=inLeft;
+		for(int i=0; i<numOfSpans && x<kGRamWidth; i++) {
+			x+=p[0];
+			const int length=p[1];
+			const uint8_t *indexColor=p+2;
+			p+=2+length;
+			int start = x<0 ? 0 : x;
+			int end = x+length>kGRamWidth ? kGRamWidth : x+length;
+			for(int s=start; s<end; s++) {
+				dstScanline[s]=inPalette[indexColor[s-x]];
+			}
+			x+=length;
+		}
+	}
+}
+// u in [inStartU,inEndU) and v in [inStartV,inEndV) are clipped already.
+static void putPackedSprite(const T2K_Sprite16colors *inSprite,const uint8_t *inPalette,
+							int inStartU,int inEndU,int inStartV,int inEndV,
+							int inStartS,int inStartT) {
+	const int bytesPerRow=(inSprite->spriteInfo.width+1)/2;
+	const int transparentColorIndex=inSprite->spriteInfo.transparentColor;
+	// the byte of 2 transparent pixels (0x00 for transparent color 0).
+	const int transparentPair = transparentColorIndex>=0
+								? transparentColorIndex*0x11 : -1;
+	const uint8_t *srcScanline=inSprite->bitmap+inStartV*bytesPerRow;
+	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(inStartS,inStartT);
+	for(int v=inStartV; v<inEndV; v++,srcScanline+=bytesPerRow,dstScanline+=kGRamWidth) {
+		const uint8_t *src=srcScanline+inStartU/2;
+		uint8_t *dst=dstScanline;
+		int u=inStartU;
+		uint8_t indexColor;
+		if((u & 1)!=0) {	// starts at the low nibble.
+			indexColor=*src++ & 0x0F;
+			if(indexColor!=transparentColorIndex) { *dst=inPalette[indexColor]; }
+			dst++;
+			u++;
+		}
+		for(; u+1<inEndU; u+=2,src++,dst+=2) {
+			const uint8_t pair=*src;
+			if(pair==transparentPair) { continue; }
+			indexColor=pair>>4;
+			if(indexColor!=transparentColorIndex) { dst[0]=inPalette[indexColor]; }
+			indexColor=pair & 0x0F;
+			if(indexColor!=transparentColorIndex) { dst[1]=inPalette[indexColor]; }
+		}
+		if(u<inEndU) {		// ends at the high nibble.
+			indexColor=*src>>4;
+			if(indexColor!=transparentColorIndex) { *dst=inPalette[indexColor]; }
+		}
+	}
+}
+// u in [inStartU,inEndU) and v in [inStartV,inEndV) are clipped already.
+// the runs of opaque pixels are copied by memcpy, which stores words
+// for the aligned part, so an opaque sprite is copied row by row.
+static void put256colorSprite(const T2K_Sprite16colors *inSprite,
+							  int inStartU,int inEndU,int inStartV,int inEndV,
+							  int inStartS,int inStartT) {
+	const int w=inSprite->spriteInfo.width;
+	const int n=inEndU-inStartU;
+	const int transparentColor=inSprite->spriteInfo.transparentColor;
+	const uint8_t *src=inSprite->bitmap+inStartV*w+inStartU;
+	uint8_t *dst=t2kGetFramebuffer()+FBA(inStartS,inStartT);
+	if(inSprite->spriteInfo.isOpaque) {
+		for(int v=inStartV; v<inEndV; v++,src+=w,dst+=kGRamWidth) {
+			memcpy(dst,src,n);
+		}
+		return;
+	}
+	for(int v=inStartV; v<inEndV; v++,src+=w,dst+=kGRamWidth) {
+		for(int i=0; i<n; ) {
+			if(src[i]==transparentColor) { i++; continue; }
+			int end=i+1;
+			while(end<n && src[end]!=transparentColor) { end++; }
+			memcpy(dst+i,src+i,end-i);
+			i=end;
+		}
+	}
+}
+
 bool t2kSprite_HasVisibleArea(T2K_SpriteInfo *inSpriteInfo,int inX,int inY,
 							  int *outLeft,int *outTop,
 							  int *outRight,int *outBottom) {
@@ -179,6 +885,157 @@ bool t2kSprite_HasVisibleArea(T2K_SpriteInfo *inSpriteInfo,int inX,int inY,
 	return true;
 }
 
+// ============================== animator ==============================
+void t2kInitSpriteAnimator(T2K_SpriteAnimator *outAnimator,T2K_Sprite16colors *inSprite,
+						   uint16_t inFrameMSec,bool inIsLoop) {
+	outAnimator->sprite=inSprite;
+	outAnimator->frameMSec=inFrameMSec;
+	outAnimator->elapsedMSec=0;
+	outAnimator->frame=0;
+	outAnimator->isLoop=inIsLoop;
+	outAnimator->isFinished=false;
+}
+// advance the frame by the elapsed time since the last update.
+void t2kUpdateSpriteAnimator(T2K_SpriteAnimator *ioAnimator,uint32_t inElapsedMSec) {
+	const int numOfFrames=ioAnimator->sprite->spriteInfo.numOfFrames;
+	if(ioAnimator->frameMSec==0 || ioAnimator->isFinished || numOfFrames<=1) { return; }
+	uint32_t t=ioAnimator->elapsedMSec+inElapsedMSec;
+	uint32_t steps=t/ioAnimator->frameMSec;
+	ioAnimator->elapsedMSec=t%ioAnimator->frameMSec;
+	if(steps==0) { return; }
+	if( ioAnimator->isLoop ) {
+		ioAnimator->frame=(ioAnimator->frame+steps)%numOfFrames;
+	} else if(ioAnimator->frame+steps>=(uint32_t)numOfFrames-1) {
+		ioAnimator->frame=numOfFrames-1;	// stop at the last frame.
+		ioAnimator->isFinished=true;
+	} else {
+		ioAnimator->frame+=steps;
+	}
+}
+bool t2kPutSpriteAnimator(const T2K_SpriteAnimator *inAnimator,int inX,int inY,
+						  uint8_t *inCustomPalette) {
+	return t2kPutSpriteFrame(inAnimator->sprite,inAnimator->frame,inX,inY,inCustomPalette);
+}
+
+// ============================== sprite list ==============================
+// sprites are added with a depth (z) and drawn at once by t2kSpriteListFlush.
+// the list is sorted by (z, band of the top) with radix sort, so the sprites
+// in a band are drawn together, and a larger z is drawn over a smaller z.
+const int kMaxSpriteListEntries=256;
+const int kSpriteListBandShift=4;		// band height is 16 pixels.
+const int kNumOfSpriteListBands=(kGRamHeight+(1<<kSpriteListBandShift)-1)>>kSpriteListBandShift;
+
+struct SpriteListEntry {
+	const T2K_Sprite16colors *sprite;
+	const uint8_t *palette;
+	int16_t left,top,right,bottom;	// not clipped
+	uint8_t z;
+	uint8_t band;
+	uint8_t frame;
+};
+static SpriteListEntry gSpriteList[kMaxSpriteListEntries];
+static uint16_t gSpriteListOrder[kMaxSpriteListEntries];
+static uint16_t gSpriteListWork[kMaxSpriteListEntries];
+static int gNumOfSpriteListEntries=0;
+
+static bool isCoveredBy(const SpriteListEntry *inEntry,const SpriteListEntry *inOpaque);
+
+// invisible sprites are culled here.
+bool t2kSpriteListAdd(T2K_Sprite16colors *inSprite,int inX,int inY,uint8_t inZ,
+					  uint8_t *inCustomPalette,uint8_t inFrame) {
+	if(inFrame>=inSprite->spriteInfo.numOfFrames) { return false; }
+	if(inSprite->bitmap==NULL
+	   || (inSprite->palette==NULL && inCustomPalette==NULL)) {
+		return false;
+	}
+	int left,top,right,bottom;
+	if(t2kSprite_HasVisibleArea(&inSprite->spriteInfo,inX,inY,
+								&left,&top,&right,&bottom)==false) {
+		return true;
+	}
+	if(gNumOfSpriteListEntries>=kMaxSpriteListEntries) {
+		ERROR("ERROR t2kSpriteListAdd: too many sprites (max=%d).\n",kMaxSpriteListEntries);
+		return false;
+	}
+	SpriteListEntry *entry=gSpriteList+gNumOfSpriteListEntries++;
+	entry->sprite=inSprite;
+	entry->palette=inCustomPalette!=NULL ? inCustomPalette : inSprite->palette;
+	entry->left=left;
+	entry->top=top;
+	entry->right=right;
+	entry->bottom=bottom;
+	entry->z=inZ;
+	entry->band=(top<0 ? 0 : top)>>kSpriteListBandShift;
+	entry->frame=inFrame;
+	return true;
+}
+
+void t2kSpriteListClear() {
+	gNumOfSpriteListEntries=0;
+}
+
+// draw all sprites in the list and clear it.
+// a sprite is skipped if it is covered by an opaque sprite drawn later.
+// return the num of drawn sprites.
+int t2kSpriteListFlush() {
+	const int n=gNumOfSpriteListEntries;
+	gNumOfSpriteListEntries=0;
+
+	// LSD radix sort: by band, and then by z (stable).
+	int count[256];
+	memset(count,0,sizeof(int)*kNumOfSpriteListBands);
+	for(int i=0; i<n; i++) { count[gSpriteList[i].band]++; }
+	for(int b=0,sum=0; b<kNumOfSpriteListBands; b++) {
+		int t=count[b]; count[b]=sum; sum+=t;
+	}
+	for(int i=0; i<n; i++) { gSpriteListWork[count[gSpriteList[i].band]++]=i; }
+
+	memset(count,0,sizeof(count));
+	for(int i=0; i<n; i++) { count[gSpriteList[i].z]++; }
+	for(int z=0,sum=0; z<256; z++) {
+		int t=count[z]; count[z]=sum; sum+=t;
+	}
+	for(int i=0; i<n; i++) {
+		uint16_t index=gSpriteListWork[i];
+		gSpriteListOrder[count[gSpriteList[index].z]++]=index;
+	}
+
+	// the opaque sprites in drawing order (reuse gSpriteListWork).
+	uint16_t *opaque=gSpriteListWork;
+	int numOfOpaque=0;
+	for(int i=0; i<n; i++) {
+		if(gSpriteList[gSpriteListOrder[i]].sprite->spriteInfo.isOpaque) {
+			opaque[numOfOpaque++]=i;	// position in gSpriteListOrder
+		}
+	}
+
+	int numOfDrawn=0;
+	int firstOpaque=0;
+	for(int i=0; i<n; i++) {
+		while(firstOpaque<numOfOpaque && opaque[firstOpaque]<=i) { firstOpaque++; }
+		const SpriteListEntry *entry=gSpriteList+gSpriteListOrder[i];
+		bool isCovered=false;
+		for(int k=firstOpaque; k<numOfOpaque && isCovered==false; k++) {
+			isCovered=isCoveredBy(entry,gSpriteList+gSpriteListOrder[opaque[k]]);
+		}
+		if( isCovered ) { continue; }
+		putSprite(entry->sprite,entry->frame,entry->palette,
+				  entry->left,entry->top,entry->right,entry->bottom);
+		numOfDrawn++;
+	}
+	return numOfDrawn;
+}
+
+// compare the visible (clipped) areas.
+static bool isCoveredBy(const SpriteListEntry *inEntry,const SpriteListEntry *inOpaque) {
+	int left  =inEntry->left<0 ? 0 : inEntry->left;
+	int top   =inEntry->top <0 ? 0 : inEntry->top;
+	int right =inEntry->right >kGRamWidth  ? kGRamWidth  : inEntry->right;
+	int bottom=inEntry->bottom>kGRamHeight ? kGRamHeight : inEntry->bottom;
+	return inOpaque->left<=left && right<=inOpaque->right
+		   && inOpaque->top<=top && bottom<=inOpaque->bottom;
+}
+
 void t2kSetDefault16colorPalette(uint8_t *outPalette) {
 	memcpy(outPalette,gGlobal16colorPalette,16);
 }
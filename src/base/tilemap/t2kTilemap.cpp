@@ -0,0 +1,441 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+#include "t2kCommon.h"
+
+#include "t2kSprite.h"
+#include "t2kTilemap.h"
+
+const int kMaxTileSize=16;
+
+static int getTileIndexColor(const T2K_Sprite16colors *inTileSet,int inU,int inV);
+static void putTileRow(const T2K_Tilemap *inTilemap,int inTileNo,int inV,int inU,int inNum,
+					   const uint8_t *inPalette,uint8_t *outDst);
+static void lookupRow(uint8_t *outDst,const uint8_t *inIndexColor,int inNum,
+					  const uint8_t *inPalette);
+static int wrap(int inValue,int inRange);
+static int getCollision(const T2K_Tilemap *inTilemap,int inTileX,int inTileY,
+						uint8_t *outTileNo=NULL);
+static int getFloorY(int inCollision,int inTileY,int inU,int inShift);
+static bool hasSolid(const T2K_Tilemap *inTilemap,int inLeftTile,int inTopTile,
+					 int inRightTile,int inBottomTile,bool inIgnoreSlopeBase=false);
+
+// the tile attributes are made here, so t2kPutTilemap skips empty tiles and
+// copies opaque tiles without testing each pixel.
+bool t2kInitTilemap(T2K_Tilemap *outTilemap,const T2K_Sprite16colors *inTileSet,
+					const uint8_t *inMap,int inMapWidth,int inMapHeight,bool inIsLoop) {
+	const T2K_SpriteInfo *info=&inTileSet->spriteInfo;
+	if(info->width!=info->height || (info->width!=8 && info->width!=16)) {
+		ERROR("ERROR t2kInitTilemap: the tile should be 8x8 or 16x16 (%dx%d).\n",
+			  info->width,info->height);
+		return false;
+	}
+	if(inMap==NULL || inMapWidth<=0 || inMapHeight<=0
+	   || UINT16_MAX<inMapWidth || UINT16_MAX<inMapHeight) {
+		ERROR("ERROR t2kInitTilemap: invalid map.\n");
+		return false;
+	}
+	outTilemap->tileSet=inTileSet;
+	outTilemap->map=inMap;
+	outTilemap->mapWidth =inMapWidth;
+	outTilemap->mapHeight=inMapHeight;
+	outTilemap->tileSize=info->width;
+	outTilemap->isLoop=inIsLoop;
+	outTilemap->scrollX=0;
+	outTilemap->scrollY=0;
+	outTilemap->collisionAttr=NULL;
+	outTilemap->numOfCollisionAttrs=0;
+
+	const int size=info->width;
+	for(int tileNo=0; tileNo<256; tileNo++) {
+		if(tileNo>=info->numOfFrames) {		// undefined tiles are not drawn.
+			outTilemap->tileAttr[tileNo]=kTA_Empty;
+			continue;
+		}
+		int numOfOpaquePixels=0;
+		for(int v=tileNo*size; v<(tileNo+1)*size; v++) {
+			for(int u=0; u<size; u++) {
+				if(getTileIndexColor(inTileSet,u,v)!=info->transparentColor) {
+					numOfOpaquePixels++;
+				}
+			}
+		}
+		outTilemap->tileAttr[tileNo] = numOfOpaquePixels==0 ? kTA_Empty
+									 : numOfOpaquePixels==size*size ? kTA_Opaque : kTA_Mixed;
+	}
+	return true;
+}
+
+void t2kSetTilemapScroll(T2K_Tilemap *ioTilemap,int inScrollX,int inScrollY) {
+	ioTilemap->scrollX=inScrollX;
+	ioTilemap->scrollY=inScrollY;
+}
+
+// each GRAM row is drawn as spans of tile rows, so only the first and the
+// last tile of the row are clipped.
+bool t2kPutTilemap(const T2K_Tilemap *inTilemap,uint8_t *inCustomPalette,
+				   int inTop,int inBottom) {
+	if(inTilemap->tileSet==NULL || inTilemap->map==NULL) { return false; }
+	if(inTop<0) { inTop=0; }
+	if(inBottom>kGRamHeight) { inBottom=kGRamHeight; }
+	const uint8_t *palette = inCustomPalette!=NULL ? inCustomPalette
+												   : inTilemap->tileSet->palette;
+	const int shift = inTilemap->tileSize==8 ? 3 : 4;
+	const int mask=inTilemap->tileSize-1;
+	const int mapPixelWidth =inTilemap->mapWidth <<shift;
+	const int mapPixelHeight=inTilemap->mapHeight<<shift;
+	uint8_t *dstScanline=t2kGetFramebuffer()+FBA(0,inTop);
+	for(int t=inTop; t<inBottom; t++,dstScanline+=kGRamWidth) {
+		int y=inTilemap->scrollY+t;
+		if( inTilemap->isLoop ) {
+			y=wrap(y,mapPixelHeight);
+		} else if(y<0 || mapPixelHeight<=y) {
+			continue;
+		}
+		const uint8_t *mapRow=inTilemap->map+(y>>shift)*inTilemap->mapWidth;
+		const int v=y & mask;
+		int s=0;
+		int x=inTilemap->scrollX;
+		if( inTilemap->isLoop ) {
+			x=wrap(x,mapPixelWidth);
+		} else if(x<0) {
+			s=-x;
+			x=0;
+		}
+		while(s<kGRamWidth) {
+			if(x>=mapPixelWidth) {
+				if( !inTilemap->isLoop ) { break; }
+				x=0;
+			}
+			const int u=x & mask;
+			int n=inTilemap->tileSize-u;
+			if(n>kGRamWidth-s) { n=kGRamWidth-s; }
+			putTileRow(inTilemap,mapRow[x>>shift],v,u,n,palette,dstScanline+s);
+			s+=n;
+			x+=n;
+		}
+	}
+	return true;
+}
+
+// ============================== collision ==============================
+void t2kSetTilemapCollision(T2K_Tilemap *ioTilemap,const uint8_t *inCollisionAttr,
+							int inNumOfAttrs) {
+	ioTilemap->collisionAttr=inCollisionAttr;
+	ioTilemap->numOfCollisionAttrs = inCollisionAttr!=NULL ? inNumOfAttrs : 0;
+}
+
+int t2kGetTileCollision(const T2K_Tilemap *inTilemap,int inTileX,int inTileY) {
+	return getCollision(inTilemap,inTileX,inTileY);
+}
+
+int t2kTilemapQueryBox(const T2K_Tilemap *inTilemap,int inLeft,int inTop,int inRight,int inBottom,
+					   T2K_TileHit *outHits,int inMaxHits) {
+	if(inRight<=inLeft || inBottom<=inTop) { return 0; }
+	const int shift = inTilemap->tileSize==8 ? 3 : 4;
+	int n=0;
+	for(int ty=inTop>>shift; ty<=(inBottom-1)>>shift; ty++) {
+		for(int tx=inLeft>>shift; tx<=(inRight-1)>>shift; tx++) {
+			uint8_t tileNo;
+			const int collision=getCollision(inTilemap,tx,ty,&tileNo);
+			if(collision==kTC_None) { continue; }
+			if(outHits!=NULL && n<inMaxHits) {
+				outHits[n].tileX=tx;
+				outHits[n].tileY=ty;
+				outHits[n].tileNo=tileNo;
+				outHits[n].collision=collision;
+			}
+			n++;
+		}
+	}
+	return n;
+}
+
+// Amanatides-Woo traversal: step into the next column or row, whichever
+// boundary the ray crosses first. a slope tile is hit where the ray crosses
+// its surface.
+bool t2kTilemapRaycast(const T2K_Tilemap *inTilemap,float inX0,float inY0,float inX1,float inY1,
+					   T2K_TileRayHit *outHit) {
+	const float size=inTilemap->tileSize;
+	const float dx=inX1-inX0;
+	const float dy=inY1-inY0;
+	int tx=(int)floorf(inX0/size);
+	int ty=(int)floorf(inY0/size);
+	const int endTX=(int)floorf(inX1/size);
+	const int endTY=(int)floorf(inY1/size);
+	const int stepX = dx>0 ? 1 : dx<0 ? -1 : 0;
+	const int stepY = dy>0 ? 1 : dy<0 ? -1 : 0;
+	const float tDeltaX = stepX!=0 ? size/fabsf(dx) : 0;
+	const float tDeltaY = stepY!=0 ? size/fabsf(dy) : 0;
+	float tMaxX = stepX>0 ? ((tx+1)*size-inX0)/dx : stepX<0 ? (tx*size-inX0)/dx : 2.0f;
+	float tMaxY = stepY>0 ? ((ty+1)*size-inY0)/dy : stepY<0 ? (ty*size-inY0)/dy : 2.0f;
+	float tEnter=0;
+	int normalX=0,normalY=0;
+	const int numOfTiles=abs(endTX-tx)+abs(endTY-ty)+1;
+	for(int i=0; i<numOfTiles; i++) {
+		uint8_t tileNo;
+		const int collision=getCollision(inTilemap,tx,ty,&tileNo);
+		if(collision!=kTC_None) {
+			float t=tEnter;
+			bool isHit=true;
+			if(collision!=kTC_Solid) {
+				// f>=0 under the surface (f is linear along the ray).
+				const float tExit = tMaxX<tMaxY ? (tMaxX<1 ? tMaxX : 1) : (tMaxY<1 ? tMaxY : 1);
+				const float left=tx*size;
+				const float top=ty*size;
+				const float sign = collision==kTC_SlopeUp ? 1 : -1;
+				const float offset = collision==kTC_SlopeUp ? size : 0;
+				const float fEnter=(inY0+dy*tEnter-top-offset)+sign*(inX0+dx*tEnter-left);
+				const float fExit =(inY0+dy*tExit -top-offset)+sign*(inX0+dx*tExit -left);
+				if(fEnter<0 && fExit<0) {
+					isHit=false;	// passes over the slope.
+				} else if(fEnter<0) {
+					t=tEnter+(tExit-tEnter)*(-fEnter)/(fExit-fEnter);
+					normalX = collision==kTC_SlopeUp ? -1 : 1;
+					normalY=-1;
+				}
+			}
+			if( isHit ) {
+				outHit->tile.tileX=tx;
+				outHit->tile.tileY=ty;
+				outHit->tile.tileNo=tileNo;
+				outHit->tile.collision=collision;
+				outHit->x=inX0+dx*t;
+				outHit->y=inY0+dy*t;
+				outHit->t=t;
+				outHit->normalX=normalX;
+				outHit->normalY=normalY;
+				return true;
+			}
+		}
+		if(tx==endTX && ty==endTY) { break; }
+		if(tMaxX<tMaxY) {
+			tEnter=tMaxX;
+			tMaxX+=tDeltaX;
+			tx+=stepX;
+			normalX=-stepX;
+			normalY=0;
+		} else {
+			tEnter=tMaxY;
+			tMaxY+=tDeltaY;
+			ty+=stepY;
+			normalX=0;
+			normalY=-stepY;
+		}
+		if(tEnter>1) { break; }
+	}
+	return false;
+}
+
+bool t2kTilemapGetFloorY(const T2K_Tilemap *inTilemap,int inX,int inY,int *outFloorY) {
+	const int shift = inTilemap->tileSize==8 ? 3 : 4;
+	const int collision=getCollision(inTilemap,inX>>shift,inY>>shift);
+	if(collision==kTC_None) { return false; }
+	*outFloorY=getFloorY(collision,inY>>shift,inX & (inTilemap->tileSize-1),shift);
+	return true;
+}
+
+// swept against the tiles: only the columns (or rows) which the leading edge
+// passes are tested. the slopes are tested at the bottom center of the box,
+// so the box can walk on them and solid tiles only block it.
+uint8_t t2kTilemapMoveBox(const T2K_Tilemap *inTilemap,int *ioLeft,int *ioTop,
+						  int inWidth,int inHeight,int inDX,int inDY) {
+	const int shift = inTilemap->tileSize==8 ? 3 : 4;
+	int left=*ioLeft;
+	int top=*ioTop;
+	uint8_t flags=0;
+
+	// x
+	const int topTile=top>>shift;
+	const int bottomTile=(top+inHeight-1)>>shift;
+	if(inDX>0) {
+		const int right=left+inWidth;
+		left+=inDX;
+		for(int tx=((right-1)>>shift)+1; tx<=(right-1+inDX)>>shift; tx++) {
+			if(hasSolid(inTilemap,tx,topTile,tx,bottomTile,true)) {
+				left=(tx<<shift)-inWidth;
+				flags|=kTH_Right;
+				break;
+			}
+		}
+	} else if(inDX<0) {
+		const int start=left;
+		left+=inDX;
+		for(int tx=(start>>shift)-1; tx>=(start+inDX)>>shift; tx--) {
+			if(hasSolid(inTilemap,tx,topTile,tx,bottomTile,true)) {
+				left=(tx+1)<<shift;
+				flags|=kTH_Left;
+				break;
+			}
+		}
+	}
+	// walk up the slope.
+	const int centerX=left+inWidth/2;
+	const int centerU=centerX & (inTilemap->tileSize-1);
+	int collision=getCollision(inTilemap,centerX>>shift,(top+inHeight-1)>>shift);
+	int floorY;
+	if(collision==kTC_SlopeUp || collision==kTC_SlopeDown) {
+		floorY=getFloorY(collision,(top+inHeight-1)>>shift,centerU,shift);
+		if(floorY<top+inHeight) {
+			top=floorY-inHeight;
+			flags|=kTH_Bottom;
+		}
+	}
+
+	// y
+	const int leftTile=left>>shift;
+	const int rightTile=(left+inWidth-1)>>shift;
+	if(inDY>0) {
+		const int bottom=top+inHeight;
+		top+=inDY;
+		// the slope can be in the current row.
+		for(int ty=(bottom-1)>>shift; ty<=(bottom-1+inDY)>>shift; ty++) {
+			collision=getCollision(inTilemap,centerX>>shift,ty);
+			if(collision==kTC_SlopeUp || collision==kTC_SlopeDown) {
+				floorY=getFloorY(collision,ty,centerU,shift);
+				if(bottom<=floorY && floorY<=bottom+inDY) {
+					top=floorY-inHeight;
+					flags|=kTH_Bottom;
+					break;
+				}
+			}
+			if(ty>(bottom-1)>>shift && hasSolid(inTilemap,leftTile,ty,rightTile,ty)) {
+				top=(ty<<shift)-inHeight;
+				flags|=kTH_Bottom;
+				break;
+			}
+		}
+	} else if(inDY<0) {
+		const int start=top;
+		top+=inDY;
+		for(int ty=(start>>shift)-1; ty>=(start+inDY)>>shift; ty--) {
+			if(hasSolid(inTilemap,leftTile,ty,rightTile,ty)) {
+				top=(ty+1)<<shift;
+				flags|=kTH_Top;
+				break;
+			}
+		}
+	}
+	*ioLeft=left;
+	*ioTop=top;
+	return flags;
+}
+
+static int getCollision(const T2K_Tilemap *inTilemap,int inTileX,int inTileY,
+						uint8_t *outTileNo) {
+	if(inTilemap->collisionAttr==NULL) { return kTC_None; }
+	if( inTilemap->isLoop ) {
+		inTileX=wrap(inTileX,inTilemap->mapWidth);
+		inTileY=wrap(inTileY,inTilemap->mapHeight);
+	} else if(inTileX<0 || inTilemap->mapWidth<=inTileX
+			  || inTileY<0 || inTilemap->mapHeight<=inTileY) {
+		return kTC_None;
+	}
+	const uint8_t tileNo=inTilemap->map[inTileY*inTilemap->mapWidth+inTileX];
+	if(outTileNo!=NULL) { *outTileNo=tileNo; }
+	return tileNo<inTilemap->numOfCollisionAttrs ? inTilemap->collisionAttr[tileNo] : (int)kTC_None;
+}
+// the floor at the pixel inU of the tile. the slopes have floors of
+// 1 to tileSize pixels high.
+static int getFloorY(int inCollision,int inTileY,int inU,int inShift) {
+	const int top=inTileY<<inShift;
+	switch(inCollision) {
+		case kTC_SlopeUp:	return top+(1<<inShift)-(inU+1);
+		case kTC_SlopeDown:	return top+inU;
+		default:			return top;
+	}
+}
+// inIgnoreSlopeBase: the solid tiles under slopes do not block, because the
+// box walks up onto them along the slopes.
+static bool hasSolid(const T2K_Tilemap *inTilemap,int inLeftTile,int inTopTile,
+					 int inRightTile,int inBottomTile,bool inIgnoreSlopeBase) {
+	for(int ty=inTopTile; ty<=inBottomTile; ty++) {
+		for(int tx=inLeftTile; tx<=inRightTile; tx++) {
+			if(getCollision(inTilemap,tx,ty)!=kTC_Solid) { continue; }
+			if( inIgnoreSlopeBase ) {
+				const int above=getCollision(inTilemap,tx,ty-1);
+				if(above==kTC_SlopeUp || above==kTC_SlopeDown) { continue; }
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static int getTileIndexColor(const T2K_Sprite16colors *inTileSet,int inU,int inV) {
+	const int w=inTileSet->spriteInfo.width;
+	if(inTileSet->spriteInfo.spriteType==kST_16colors_Packed) {
+		uint8_t pair=inTileSet->bitmap[inV*((w+1)/2)+inU/2];
+		return (inU & 1)==0 ? pair>>4 : pair & 0x0F;
+	} else {
+		return inTileSet->bitmap[inV*w+inU];
+	}
+}
+// draw inNum pixels from (inU,inV) of the tile.
+static void putTileRow(const T2K_Tilemap *inTilemap,int inTileNo,int inV,int inU,int inNum,
+					   const uint8_t *inPalette,uint8_t *outDst) {
+	const uint8_t attr=inTilemap->tileAttr[inTileNo];
+	if(attr==kTA_Empty) { return; }
+	const T2K_Sprite16colors *tileSet=inTilemap->tileSet;
+	const int size=inTilemap->tileSize;
+	const int v=inTileNo*size+inV;
+	const int transparentColorIndex=tileSet->spriteInfo.transparentColor;
+	const uint8_t *indexColor;
+	uint8_t unpacked[kMaxTileSize];
+	if(tileSet->spriteInfo.spriteType==kST_16colors_Packed) {
+		const uint8_t *src=tileSet->bitmap+v*(size/2);
+		for(int i=0; i<inNum; i++) {
+			const int u=inU+i;
+			unpacked[i] = (u & 1)==0 ? src[u/2]>>4 : src[u/2] & 0x0F;
+		}
+		indexColor=unpacked;
+	} else {
+		indexColor=tileSet->bitmap+v*size+inU;
+	}
+	if(attr==kTA_Opaque) {
+		if(tileSet->spriteInfo.spriteType==kST_256colors && inPalette==tileSet->palette) {
+			memcpy(outDst,indexColor,inNum);	// RGB332 already
+		} else {
+			lookupRow(outDst,indexColor,inNum,inPalette);
+		}
+		return;
+	}
+	for(int i=0; i<inNum; i++) {
+		if(indexColor[i]==transparentColorIndex) { continue; }
+		outDst[i]=inPalette[indexColor[i]];
+	}
+}
+// 4 pixels are stored at a time if outDst is word aligned (GRAM is little endian).
+static void lookupRow(uint8_t *outDst,const uint8_t *inIndexColor,int inNum,
+					  const uint8_t *inPalette) {
+	int i=0;
+	for(; i<inNum && ((uintptr_t)(outDst+i) & 3)!=0; i++) {
+		outDst[i]=inPalette[inIndexColor[i]];
+	}
+	for(; i+4<=inNum; i+=4) {
+		*(uint32_t *)(outDst+i)=  (uint32_t)inPalette[inIndexColor[i  ]]
+								| (uint32_t)inPalette[inIndexColor[i+1]]<<8
+								| (uint32_t)inPalette[inIndexColor[i+2]]<<16
+								| (uint32_t)inPalette[inIndexColor[i+3]]<<24;
+	}
+	for(; i<inNum; i++) {
+		outDst[i]=inPalette[inIndexColor[i]];
+	}
+}
+// return inValue mod inRange in [0,inRange).
+static int wrap(int inValue,int inRange) {
+	int t=inValue%inRange;
+	return t<0 ? t+inRange : t;
+}
+
@@ -39,6 +39,7 @@ struct CommandPacket {
 	float   freqHz;
 	int16_t durationMSec;
 	uint8_t volume;
+	const T2K_ToneModulation *modulation;	// NULL means no modulation.
 };
 
 struct ToneInfo {
@@ -48,6 +49,48 @@ struct ToneInfo {
 	float scale;			// minus means no data.
 };
 
+// T2K_ToneModulation in fixed point (Q16: 1.0 == 0x10000).
+// evaluated once per kModulationBlockLength samples by tonePump.
+struct ToneModulation {
+	uint8_t flags;				// kMod_...
+	uint16_t vibratoPhase;		// 0x10000 == 1 cycle
+	uint16_t vibratoStep;		// phase step per block
+	int32_t vibratoDepth;		// Q16 (freq ratio at peak - 1)
+	int32_t portamentoRatio;	// Q16 (current freq / target freq)
+	int32_t portamentoStep;		// Q16 per block
+	uint16_t portamentoBlocks;	// num of blocks left
+	uint8_t arpeggioIndex;
+	uint16_t arpeggioBlocks;	// blocks per step
+	uint16_t arpeggioBlockCount;
+	int32_t arpeggioRatio[3];	// Q16
+};
+enum {
+	kMod_Vibrato   =0x01,
+	kMod_Portamento=0x02,
+	kMod_Arpeggio  =0x04,
+};
+
+// a packet of the tone sequence queue.
+struct ToneSeqItem {
+	ToneInfo toneInfo;
+	ToneModulation modulation;
+};
+
+// a sample voice for t2kPlayPCM (written only by tonePump).
+struct PCMVoice {
+	bool isAlive;
+	uint8_t channel;			// for master volume.
+	const int8_t *pcm;
+	uint32_t length;
+	uint32_t pos;
+};
+// a request of t2kPlayPCM, started on a voice by tonePump.
+struct PCMStartPacket {
+	uint8_t channel;
+	const int8_t *pcm;
+	uint32_t length;
+};
+
 const float kPI=3.14159265359f;
 const float k2PI=2*kPI;
 
@@ -62,6 +105,17 @@ const int kLengthOfDmaBuffer=32;	// num of samples at single channel.
 
 const int kToneSeqQueueLength=32;
 
+const int kModulationBlockLength=32;	// num of samples.
+const float kModulationBlockMSec=kModulationBlockLength*1000.0f/(kI2S_SamplingHz*2);
+const int kVibratoTableLength=64;		// for a cycle.
+const float kMaxVibratoDepthCents=1200;	// an octave.
+const float kMaxVibratoRateHz=50;		// far below the block rate (250Hz).
+
+const int kSamplesPerMSec=kI2S_SamplingHz*2/1000;	// tonePump writes 2 samples at a time.
+const int kNumOfPCMVoices=4;
+const float kToneScale=0x8000/3.0f;			// scale of a tone at volume 255.
+const float kPCMScale=kToneScale/127;		// int8_t PCM (127 == kToneScale)
+
 static volatile bool gQuiet=true;
 
 static AXP192 gAxp;
@@ -69,12 +123,29 @@ static AXP192 gAxp;
 static volatile ToneInfo gToneInfo[kNumOfChannels];
 static QueueHandle_t gToneSeqQueue[kNumOfChannels];
 static volatile float gMasterVolume[kNumOfChannels];	// 0 to 1
+static volatile uint32_t gPlayedSamples[kNumOfChannels];	// cleared by t2kClearToneSeq
+
+// owned by tonePump (except for clearing flags by setToneInfo).
+static float gBaseDeltaTheta[kNumOfChannels];
+static ToneModulation gToneModulation[kNumOfChannels];
+static int16_t gVibratoTable[kVibratoTableLength];	// sin in Q15
+
+static volatile PCMVoice gPCMVoice[kNumOfPCMVoices];
+static QueueHandle_t gPCMStartQueue;
 
 static void tonePump(void * /* inARGS */);
 static bool getNextTone(int inChannel);
 static bool soundCommandDispatcher(CommandPacket *inPacket,int inWait);
 static bool setToneInfo(CommandPacket *inPacket);
 static bool appendSeq(CommandPacket *inCommandPacket,/* bool inIsAlive, */ int inWait);
+static void makeToneSeqItem(ToneSeqItem *outItem,float inFreqHz,int16_t inDurationMSec,
+							uint8_t inVolume,const T2K_ToneModulation *inModulation);
+static void setToneModulation(ToneModulation *outModulation,
+							  const T2K_ToneModulation *inModulation,float inFreqHz);
+static float modulate(ToneModulation *ioModulation,float inBaseDeltaTheta);
+static float synthesize(float *ioTheta,float inDeltaTheta,float inScale);
+static void startPCMVoices();
+static bool isAnyPCMVoiceAlive();
 static void dumpChannelInfo();
 static esp_err_t soundWrite(int16_t inVal);
 
@@ -112,16 +183,28 @@ bool t2kSCoreInit() {
 	i2s_set_pin(kI2SPort,&tx_pin_config);
 
 	i2s_stop(kI2SPort);
+	for(int i=0; i<kVibratoTableLength; i++) {
+		gVibratoTable[i]=(int16_t)(sin(k2PI*i/kVibratoTableLength)*0x7FFF);
+	}
 	for(int i=0; i<kNumOfChannels; i++) {
 		gToneInfo[i].isAlive=false;
+		gToneModulation[i].flags=0;
 		// gToneInfo[i].theta=0;
-		gToneSeqQueue[i]=xQueueCreate(kToneSeqQueueLength,sizeof(ToneInfo));
+		gToneSeqQueue[i]=xQueueCreate(kToneSeqQueueLength,sizeof(ToneSeqItem));
 		if(gToneSeqQueue[i]==0) {
 			Serial.printf("t2kSCoreInit: can not create tone seq queue %d\n",i);
 			return false;
 		}
 		gMasterVolume[i]=0.5f;
 	}
+	for(int i=0; i<kNumOfPCMVoices; i++) {
+		gPCMVoice[i].isAlive=false;
+	}
+	gPCMStartQueue=xQueueCreate(kNumOfPCMVoices,sizeof(PCMStartPacket));
+	if(gPCMStartQueue==0) {
+		Serial.printf("t2kSCoreInit: can not create PCM start queue\n");
+		return false;
+	}
 
 	return true;
 }
@@ -151,11 +234,19 @@ bool t2kTone(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t inV
 	packet.freqHz =inFreqHz;
 	packet.durationMSec=inDurationMSec;
 	packet.volume=inVolume;
+	packet.modulation=NULL;
 	gQuiet=false;
 	return soundCommandDispatcher(&packet,portMAX_DELAY);
 }
 
 bool t2kAddTone(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t inVolume) {
+	return t2kAddToneEx(inChannel,inFreqHz,inDurationMSec,inVolume,NULL);
+}
+
+// same as t2kAddTone, but the pitch is modulated by t2kSCore while the tone
+// is played. so a vibrato or a slide needs only one queue entry.
+bool t2kAddToneEx(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t inVolume,
+				  const T2K_ToneModulation *inModulation) {
 	if(inChannel>=kNumOfChannels) { return false; }
 	CommandPacket packet;
 	packet.command=SC_Seq;
@@ -163,6 +254,7 @@ bool t2kAddTone(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t
 	packet.freqHz =inFreqHz;
 	packet.durationMSec=inDurationMSec;
 	packet.volume=inVolume;
+	packet.modulation=inModulation;
 	gQuiet=false;
 	return soundCommandDispatcher(&packet,0);
 }
@@ -177,7 +269,10 @@ bool t2kStartToneSeq(uint8_t inChannel) {
 bool t2kClearToneSeq(uint8_t inChannel) {
 	if(inChannel>=kNumOfChannels) { return false; }
 	if(inChannel==kAllChannels) {
-		for(int i=0; i<kNumOfChannels; i++) { gToneInfo[i].isAlive=false; }
+		for(int i=0; i<kNumOfChannels; i++) {
+			gToneInfo[i].isAlive=false;
+			gPlayedSamples[i]=0;
+		}
 		gQuiet=true;
 		bool result=true;
 		for(int i=0; i<kNumOfChannels; i++) {
@@ -186,6 +281,7 @@ bool t2kClearToneSeq(uint8_t inChannel) {
 		return result;
 	} else {
 		gToneInfo[inChannel].isAlive=false;
+		gPlayedSamples[inChannel]=0;
 		bool quiet=true;
 		for(int i=0; i<kNumOfChannels; i++) {
 			if (gToneInfo[i].isAlive ) {
@@ -193,11 +289,73 @@ bool t2kClearToneSeq(uint8_t inChannel) {
 				break;
 			}
 		}
-		gQuiet=quiet;
+		gQuiet=quiet && isAnyPCMVoiceAlive()==false;
 		return xQueueReset(gToneSeqQueue[inChannel])==pdTRUE;
 	}
 }
 
+// total duration of the tones (and rests) played since t2kClearToneSeq.
+uint32_t t2kGetToneSeqPlayedMSec(uint8_t inChannel) {
+	if(inChannel>=kNumOfChannels) { return 0; }
+	return (uint64_t)gPlayedSamples[inChannel]*1000/(kI2S_SamplingHz*2);
+}
+
+// play a PCM sample (made by t2kRenderTone) with the master volume of inChannel.
+// the sample is mixed on a free voice, so the same sample can be overlapped.
+// if all voices are busy, the voice played the longest is replaced.
+// the request is passed to tonePump (started within a modulation block), so
+// the voices are never rewritten while tonePump reads them. false if
+// kNumOfPCMVoices requests are already waiting.
+// note: inPCM must be kept until it is played.
+bool t2kPlayPCM(uint8_t inChannel,const int8_t *inPCM,uint32_t inLength) {
+	if(inChannel>=kNumOfChannels || inPCM==NULL || inLength==0) { return false; }
+	PCMStartPacket packet;
+	packet.channel=inChannel;
+	packet.pcm=inPCM;
+	packet.length=inLength;
+	if(xQueueSend(gPCMStartQueue,&packet,0)!=pdTRUE) { return false; }
+	gQuiet=false;
+	return true;
+}
+
+// offline rendering with the same synthesizer as tonePump.
+bool t2kInitPCMRenderer(T2K_PCMRenderer *outRenderer,uint32_t inMSec) {
+	outRenderer->capacity=inMSec*kSamplesPerMSec;
+	outRenderer->length=0;
+	outRenderer->theta=0;
+	outRenderer->buffer=(int8_t *)malloc(outRenderer->capacity);
+	if(outRenderer->buffer==NULL) {
+		Serial.printf("t2kInitPCMRenderer: can not alloc %u bytes\n",outRenderer->capacity);
+		return false;
+	}
+	return true;
+}
+bool t2kRenderTone(T2K_PCMRenderer *ioRenderer,float inFreqHz,int16_t inDurationMSec,
+				   uint8_t inVolume,const T2K_ToneModulation *inModulation) {
+	if(inDurationMSec<=0) { return true; }
+	uint32_t n=inDurationMSec*kSamplesPerMSec;
+	if(ioRenderer->length+n>ioRenderer->capacity) { return false; }
+	int8_t *p=ioRenderer->buffer+ioRenderer->length;
+	ioRenderer->length+=n;
+	if(inFreqHz==0 || inVolume==0) {
+		memset(p,0,n);
+		return true;
+	}
+	ToneSeqItem item;
+	makeToneSeqItem(&item,inFreqHz,inDurationMSec,inVolume,inModulation);
+	float baseDeltaTheta=item.toneInfo.deltaTheta;
+	float deltaTheta=baseDeltaTheta;
+	bool needModulate=item.modulation.flags!=0 && baseDeltaTheta>=0;
+	for(uint32_t i=0; i<n; i++) {
+		if(needModulate && i%kModulationBlockLength==0) {
+			deltaTheta=modulate(&item.modulation,baseDeltaTheta);
+		}
+		float t=synthesize(&ioRenderer->theta,deltaTheta,item.toneInfo.scale)/kPCMScale;
+		*p++=(int8_t)(t>127 ? 127 : t<-127 ? -127 : t);
+	}
+	return true;
+}
+
 void t2kQuiet() {
 	gQuiet=true;
 }
@@ -216,8 +374,18 @@ static void tonePump(void * /* inARGS */) {
 	float tmp;
 	const float dtMSec=1000.0f/(kI2S_SamplingHz*2);
 	volatile ToneInfo *toneInfo;
+	int blockCount=0;
 	for(;;) {
 		if( gQuiet ) { i2s_zero_dma_buffer(kI2SPort); }
+		if(++blockCount>=kModulationBlockLength) {
+			blockCount=0;
+			startPCMVoices();
+			for(int i=0; i<kNumOfChannels; i++) {
+				if(gToneModulation[i].flags!=0 && gToneInfo[i].deltaTheta>=0) {
+					gToneInfo[i].deltaTheta=modulate(gToneModulation+i,gBaseDeltaTheta[i]);
+				}
+			}
+		}
 		t=0;
 		toneInfo=gToneInfo;
 		for(int i=0; i<kNumOfChannels; i++,toneInfo++) {
@@ -225,15 +393,12 @@ static void tonePump(void * /* inARGS */) {
 				if(toneInfo->scale<0) {
 					if(getNextTone(i)==false) { continue; }
 				}
+				gPlayedSamples[i]++;
+				tmp=synthesize(theta+i,toneInfo->deltaTheta,toneInfo->scale);
 				if(toneInfo->deltaTheta<0) {
-					// noise
-					DEBUG_LN("NOISE");
-					t+=(((float)rand()/RAND_MAX)*2-1)*toneInfo->scale;
+					t+=tmp;		// noise
 				} else {
-					tmp=theta[i]+toneInfo->deltaTheta;
-					tmp-=((int)(tmp/k2PI))*k2PI;
-					theta[i]=tmp;
-					t+=sin(theta[i])*toneInfo->scale*gMasterVolume[i];
+					t+=tmp*gMasterVolume[i];
 				}
 			}
 			if(toneInfo->durationMSec>0) { toneInfo->durationMSec-=dtMSec; }
@@ -244,6 +409,14 @@ static void tonePump(void * /* inARGS */) {
 				}
 			}
 		}
+		for(int i=0; i<kNumOfPCMVoices; i++) {
+			volatile PCMVoice *voice=gPCMVoice+i;
+			if(voice->isAlive==false) { continue; }
+			uint32_t pos=voice->pos;
+			t+=voice->pcm[pos]*kPCMScale*gMasterVolume[voice->channel];
+			if(++pos>=voice->length) { voice->isAlive=false; }
+			voice->pos=pos;
+		}
 		int16_t dataToSend=(int16_t)(t+gDeltaSigma);
 		gDeltaSigma=(t+gDeltaSigma)-dataToSend;
 		soundWrite(dataToSend);
@@ -252,12 +425,17 @@ static void tonePump(void * /* inARGS */) {
 static bool getNextTone(int inChannel) {
 	if(inChannel<0 || kNumOfChannels<=inChannel) { return false; }
 
-	ToneInfo nextTone;
-	if(xQueueReceive(gToneSeqQueue[inChannel],&nextTone,0)==pdTRUE) {
+	ToneSeqItem nextItem;
+	if(xQueueReceive(gToneSeqQueue[inChannel],&nextItem,0)==pdTRUE) {
+		const ToneInfo &nextTone=nextItem.toneInfo;
 		volatile ToneInfo *toneInfo=gToneInfo+inChannel;
 		toneInfo->isAlive=true;
 		// toneInfo->theta <- do not change
-		toneInfo->deltaTheta=nextTone.deltaTheta;
+		gBaseDeltaTheta[inChannel]=nextTone.deltaTheta;
+		gToneModulation[inChannel]=nextItem.modulation;
+		toneInfo->deltaTheta = nextItem.modulation.flags!=0 && nextTone.deltaTheta>=0
+							   ? modulate(gToneModulation+inChannel,nextTone.deltaTheta)
+							   : nextTone.deltaTheta;
 		toneInfo->durationMSec=(float)nextTone.durationMSec;
 		toneInfo->scale=nextTone.scale;
 //Serial.printf("getNexTone: ch=%d deltaTheta=%f\n",inChannel,toneInfo->deltaTheta);
@@ -298,6 +476,7 @@ static bool setToneInfo(CommandPacket *inPacket) {
 	if(xQueueReset(gToneSeqQueue[ch])!=pdTRUE) {
 		Serial.printf("setToneInfo: can not reset tone seq queue %d\n",ch);
 	}
+	gToneModulation[ch].flags=0;
 	const float f=inPacket->freqHz;
 	if(f==0) {
 		gToneInfo[ch].isAlive=false;
@@ -313,7 +492,7 @@ static bool setToneInfo(CommandPacket *inPacket) {
 		// use same value to theta for continuity.
 		DEBUG("ch=%d duration=%f\n",ch,gToneInfo[ch].durationMSec);
 	}
-	gToneInfo[ch].scale=inPacket->volume/255.0f*0x8000/3.0f;
+	gToneInfo[ch].scale=inPacket->volume/255.0f*kToneScale;
 	return true;
 }
 static bool appendSeq(CommandPacket *inCommandPacket,/* bool inIsAlive, */ int inWait) {
@@ -322,18 +501,128 @@ static bool appendSeq(CommandPacket *inCommandPacket,/* bool inIsAlive, */ int i
 		DEBUG("t2kSCore (tone): No shuch channels (ch=%d)\n",ch);
 		return false;
 	}
-	float f=inCommandPacket->freqHz;
-	ToneInfo toneInfoPacket;
+	ToneSeqItem item;
+	makeToneSeqItem(&item,inCommandPacket->freqHz,inCommandPacket->durationMSec,
+					inCommandPacket->volume,inCommandPacket->modulation);
+	return xQueueSend(gToneSeqQueue[ch],&item,inWait)==pdTRUE;
+}
+static void makeToneSeqItem(ToneSeqItem *outItem,float inFreqHz,int16_t inDurationMSec,
+							uint8_t inVolume,const T2K_ToneModulation *inModulation) {
+	ToneInfo &toneInfoPacket=outItem->toneInfo;
 	toneInfoPacket.isAlive=true; // inIsAlive;
 	// toneInfo.theta <- don't care
-	if(f>=0) {
-		toneInfoPacket.deltaTheta=k2PI*f/(kI2S_SamplingHz*2);	// [rad/msec]
+	if(inFreqHz>=0) {
+		toneInfoPacket.deltaTheta=k2PI*inFreqHz/(kI2S_SamplingHz*2);	// [rad/msec]
 	} else {
 		toneInfoPacket.deltaTheta=-1;	// mark noise.
 	}
-	toneInfoPacket.durationMSec=(float)inCommandPacket->durationMSec;
-	toneInfoPacket.scale=inCommandPacket->volume/255.0f*0x8000/3.0f;
-	return xQueueSend(gToneSeqQueue[ch],&toneInfoPacket,inWait)==pdTRUE;
+	toneInfoPacket.durationMSec=(float)inDurationMSec;
+	toneInfoPacket.scale=inVolume/255.0f*kToneScale;
+	setToneModulation(&outItem->modulation,inModulation,inFreqHz);
+}
+
+// convert to fixed point. (float is used only here, not in tonePump)
+static void setToneModulation(ToneModulation *outModulation,
+							  const T2K_ToneModulation *inModulation,float inFreqHz) {
+	outModulation->flags=0;
+	if(inModulation==NULL || inFreqHz<=0) { return; }
+
+	if(inModulation->vibratoDepthCents>0 && inModulation->vibratoRateHz>0) {
+		outModulation->flags|=kMod_Vibrato;
+		outModulation->vibratoPhase=0;
+		float rate=inModulation->vibratoRateHz;
+		if(rate>kMaxVibratoRateHz) { rate=kMaxVibratoRateHz; }
+		outModulation->vibratoStep=(uint16_t)(rate*kModulationBlockMSec/1000*0x10000);
+		float cents=inModulation->vibratoDepthCents;
+		if(cents>kMaxVibratoDepthCents) { cents=kMaxVibratoDepthCents; }
+		outModulation->vibratoDepth=(int32_t)((pow(2,cents/1200.0f)-1)*0x10000);
+	}
+	if(inModulation->portamentoFromHz>0 && inModulation->portamentoMSec>0) {
+		int blocks=(int)(inModulation->portamentoMSec/kModulationBlockMSec);
+		if(blocks<1) { blocks=1; }
+		if(blocks>UINT16_MAX) { blocks=UINT16_MAX; }
+		int32_t ratio=(int32_t)(inModulation->portamentoFromHz/inFreqHz*0x10000);
+		outModulation->flags|=kMod_Portamento;
+		outModulation->portamentoRatio=ratio;
+		outModulation->portamentoStep=(0x10000-ratio)/blocks;
+		outModulation->portamentoBlocks=blocks;
+	}
+	if(inModulation->arpeggioMSec>0) {
+		int blocks=(int)(inModulation->arpeggioMSec/kModulationBlockMSec);
+		if(blocks<1) { blocks=1; }
+		if(blocks>UINT16_MAX) { blocks=UINT16_MAX; }
+		outModulation->flags|=kMod_Arpeggio;
+		outModulation->arpeggioIndex=0;
+		outModulation->arpeggioBlocks=blocks;
+		outModulation->arpeggioBlockCount=0;
+		outModulation->arpeggioRatio[0]=0x10000;
+		for(int i=0; i<2; i++) {
+			outModulation->arpeggioRatio[i+1]=(int32_t)(pow(2,inModulation->arpeggio[i]/12.0f)
+														*0x10000);
+		}
+	}
+}
+
+// advance the modulation by a block, and return the modulated deltaTheta.
+static float modulate(ToneModulation *ioModulation,float inBaseDeltaTheta) {
+	ToneModulation *mod=ioModulation;
+	int64_t ratio=0x10000;	// Q16
+	if(mod->flags & kMod_Portamento) {
+		ratio=ratio*mod->portamentoRatio>>16;
+		if(mod->portamentoBlocks>0) {
+			mod->portamentoBlocks--;
+			mod->portamentoRatio+=mod->portamentoStep;
+		} else {
+			mod->portamentoRatio=0x10000;	// reached the target freq.
+		}
+	}
+	if(mod->flags & kMod_Arpeggio) {
+		ratio=ratio*mod->arpeggioRatio[mod->arpeggioIndex]>>16;
+		if(++mod->arpeggioBlockCount>=mod->arpeggioBlocks) {
+			mod->arpeggioBlockCount=0;
+			mod->arpeggioIndex=(mod->arpeggioIndex+1)%3;
+		}
+	}
+	if(mod->flags & kMod_Vibrato) {
+		int16_t s=gVibratoTable[mod->vibratoPhase>>10];		// 16 bits -> 6 bits
+		ratio=ratio*(0x10000+(((int64_t)mod->vibratoDepth*s)>>15))>>16;
+		mod->vibratoPhase+=mod->vibratoStep;
+	}
+	return inBaseDeltaTheta*(int32_t)ratio*(1.0f/0x10000);
+}
+// a sample of a tone (minus deltaTheta means noise).
+static float synthesize(float *ioTheta,float inDeltaTheta,float inScale) {
+	if(inDeltaTheta<0) {
+		DEBUG_LN("NOISE");
+		return (((float)rand()/RAND_MAX)*2-1)*inScale;
+	}
+	float tmp=*ioTheta+inDeltaTheta;
+	tmp-=((int)(tmp/k2PI))*k2PI;
+	*ioTheta=tmp;
+	return sin(tmp)*inScale;
+}
+// called by tonePump only.
+static void startPCMVoices() {
+	PCMStartPacket packet;
+	while(xQueueReceive(gPCMStartQueue,&packet,0)==pdTRUE) {
+		volatile PCMVoice *voice=gPCMVoice;
+		for(int i=0; i<kNumOfPCMVoices; i++) {
+			if(gPCMVoice[i].isAlive==false) { voice=gPCMVoice+i; break; }
+			if(gPCMVoice[i].pos>voice->pos) { voice=gPCMVoice+i; }
+		}
+		voice->channel=packet.channel;
+		voice->pcm=packet.pcm;
+		voice->length=packet.length;
+		voice->pos=0;
+		voice->isAlive=true;
+	}
+}
+static bool isAnyPCMVoiceAlive() {
+	if(uxQueueMessagesWaiting(gPCMStartQueue)>0) { return true; }
+	for(int i=0; i<kNumOfPCMVoices; i++) {
+		if(gPCMVoice[i].isAlive) { return true; }
+	}
+	return false;
 }
 
 // write to I2S DMA buffer
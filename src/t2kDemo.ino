@@ -35,25 +35,19 @@ const char *gShoot="T200L32O5 CE";
 // composed by Utarin, MML encoded by KojiSaito.
 const char *gSampleBGM="@M120 @V99 @K-3"
 					   "< $"
+					   "["
 					   "c12r24e12r24   c12r24e12r24   c24r48c24r48e12r24   c12r24e12r24"
 					   ">b12r24<d12r24 >b12r24<d12r24 >b24r48b24r48<d12r24 >b12r24<d12r24"
 					   ">a12r24<c12r24 >a12r24<c12r24 >a24r48a24r48<c12r24 >a12r24<c12r24"
 					   ">g12r24b12r24  g12r24b=12r24  g24r48g24r48b=12r24  g12r24b=12r24"
 					   "<"
-					   "c12r24e12r24   c12r24e12r24   c24r48c24r48e12r24   c12r24e12r24"
-					   ">b12r24<d12r24 >b12r24<d12r24 >b24r48b24r48<d12r24 >b12r24<d12r24"
-					   ">a12r24<c12r24 >a12r24<c12r24 >a24r48a24r48<c12r24 >a12r24<c12r24"
-					   ">g12r24b12r24  g12r24b=12r24  g24r48g24r48b=12r24  g12r24b=12r24"
-					   "<"
+					   "]2"
+					   "["
 					   "e16r16e16r16 e8r16e16 r16e16r16e16 r16e16r16e16"
 					   "d16r16d16r16 d8r16d16 r16d16r16d16 r16d16r16d16"
 					   "f16r16f16r16 f8r16f16 r16f16r16f16 r16f16r16f16"
 					   "e16r16e16r16 e8r16d16 d8r16c16     c16r16d16r16"
-					   " "
-					   "e16r16e16r16 e8r16e16 r16e16r16e16 r16e16r16e16"
-					   "d16r16d16r16 d8r16d16 r16d16r16d16 r16d16r16d16"
-					   "f16r16f16r16 f8r16f16 r16f16r16f16 r16f16r16f16"
-					   "e16r16e16r16 e8r16d16 d8r16c16     c16r16d16r16";
+					   "]2";
 
 static const char *gBallSpritePattern[]={
 	"__RRRR__",
@@ -97,6 +91,11 @@ static T2K_Sprite16colors gAlienSprite;
 const int kNumOfStars=100;
 static int gStarXY[kNumOfStars];
 
+static uint8_t gTitleLayerArea[11*10];
+static uint8_t gMenuItemLayerArea[3][12*10];
+static T2K_TextLayer gTitleLayer;
+static T2K_TextLayer gMenuItemLayer[3];
+
 static void topMenu();
 static void blinkTopMenu();
 static void drawTopMenu(int inSelectedItem,int inCounterForBlink);
@@ -161,6 +160,10 @@ void setup() {
 	Serial.printf("internal Free Heap %d\n",ESP.getFreeHeap());
 
 	t2kFontInit();
+	t2kInitTextLayer(&gTitleLayer,11,false,gTitleLayerArea);
+	for(int i=0; i<3; i++) {
+		t2kInitTextLayer(&gMenuItemLayer[i],12,false,gMenuItemLayerArea[i]);
+	}
 	Serial.println("=== t2kFont INIT DONE");
 
 	bool result=t2kMmlInit();
@@ -180,6 +183,7 @@ void setup() {
 	if(t2kCheckMML(gSampleBGM)==false) { Serial.printf("MML ERROR BGM\n"); }
 	if(t2kCheckMML(gShoot)==false) { Serial.printf("MML ERROR Paro\n"); }
 	Serial.printf("all MML check done.\n");
+	if(t2kCacheMML(gShoot)==false) { Serial.printf("MML CACHE ERROR Paro\n"); }
 
 	initBallSpritePalette();
 	if(t2kInitSprite(&gBallSprite,8,8,gBallSpritePattern,
@@ -187,11 +191,13 @@ void setup() {
 		Serial.printf("BALL SPRITE ERROR\n");
 	}
 
-	if(t2kInitSprite(&gMyShipSprite,9,9,gMyShipPattern,4,4)==false) {
+	if(t2kInitSprite(&gMyShipSprite,9,9,gMyShipPattern,4,4)==false
+	   || t2kCompileSprite(&gMyShipSprite)==false) {
 		Serial.printf("MyShip SPRITE ERROR\n");
 	}
 
-	if(t2kInitSprite(&gAlienSprite,8,8,gAlienPattern)==false) {
+	if(t2kInitSprite(&gAlienSprite,8,8,gAlienPattern)==false
+	   || t2kCompileSprite(&gAlienSprite)==false) {
 		Serial.printf("Alien SPRITE ERROR\n");
 	}
 
@@ -324,7 +330,12 @@ static void mmlTest() {
 		t2kFillRect(sx-20,14, 18,2,rainbow);
 	}
 
-	t2kPrintf(4,kWhite,"SCPRE: %07d",gFrameCount);
+	char scoreBuffer[16];
+	T2K_Text score;
+	t2kTextInit(&score,scoreBuffer,sizeof(scoreBuffer));
+	t2kTextAddStr(&score,"SCPRE: ");
+	t2kTextAddInt(&score,gFrameCount,7,'0');
+	t2kPutText((kGRamWidth-score.length*8)/2,4,kWhite,&score);
 	t2kPrintf(110,kWhite,"SELECT+START = >TOP");
 
 	if(t2kIsPressedStart() && t2kIsPressedSelect()) {
@@ -392,7 +403,9 @@ static void drawTopMenu(int inSelectedItem,int inCounterForBlink) {
 	int x4=(int)(r*cos(t2+pi)+cx),y4=(int)(r*sin(t2+pi)+cy);
 	t2kDrawLine(x3,y3,x4,y4,RGB(1,4,3));
 
-	t2kPrintf(50,kWhite,"DEMO TESTER");
+	// the labels are rendered once (see t2kSetTextLayer).
+	t2kSetTextLayer(&gTitleLayer,"DEMO TESTER",kWhite);
+	t2kPutTextLayer(&gTitleLayer,(kGRamWidth-t2kGetTextLayerWidth(&gTitleLayer))/2,50);
 
 	const char *item[3]={
 		"PLAY MML",
@@ -403,7 +416,8 @@ static void drawTopMenu(int inSelectedItem,int inCounterForBlink) {
 		if(inCounterForBlink>0 && i==inSelectedItem && inCounterForBlink%4>=2) {
 			continue;
 		} else {
-			t2kPrintf(47,70+i*10,kWhite,item[i]);
+			t2kSetTextLayer(&gMenuItemLayer[i],item[i],kWhite);
+			t2kPutTextLayer(&gMenuItemLayer[i],47,70+i*10);
 		}
 		if(inCounterForBlink>0 && inCounterForBlink%4==0) {
 			t2kPlayMML(0,"L96 O6 CEG");
@@ -494,8 +508,9 @@ static void spriteTest() {
 		if(gBall[i].x+8>=kGRamWidth) { gBall[i].x=kGRamWidth-8-1; gBall[i].dx*=-1; }
 		if(gBall[i].y<0) { gBall[i].y=0; gBall[i].dy*=-1; }
 		if(gBall[i].y+8>=kGRamHeight) { gBall[i].y=kGRamHeight-8-1; gBall[i].dy*=-1; }
-		t2kPutSprite(&gBallSprite,gBall[i].x,gBall[i].y,gBallSpritePalette[i%7]);
+		t2kSpriteListAdd(&gBallSprite,gBall[i].x,gBall[i].y,i,gBallSpritePalette[i%7]);
 	}
+	t2kSpriteListFlush();
 	uint8_t color = gNumOfSprite<MAX_BALLS ? kWhite : kCyan;
 	t2kPrintf(60,color,"Num of Sprites %03d",gNumOfSprite);
 	t2kPrintf(4,110,kWhite,"SELECT+START = >TOP");
@@ -0,0 +1,118 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// the core functions used by src/base, for the tools on the host PC
+// (build with -DTEST_ON_PC -Iinclude -Itools/pc).
+//
+// graphics: GRAM is in memory, and it is not sent to the LCD.
+// sound: the tone queues have the same length as t2kSCore, and nothing is
+// played. t2kPCPlayTones() empties the queues as if the tones were played.
+
+#include <t2kCommon.h>
+#include <t2kGCore.h>
+#include <t2kSCore.h>
+#include "t2kPCCore.h"
+
+// ============================== graphics ==============================
+static uint8_t gGRam[kGRamWidth*kGRamHeight];
+
+uint8_t *t2kGetFramebuffer() {
+	return gGRam;
+}
+void t2kFill(uint8_t inColorRGB332) {
+	memset(gGRam,inColorRGB332,sizeof(gGRam));
+}
+void t2kPSet(int inX,int inY,uint8_t inColorRGB332) {
+	if( isInvalidXY(inX,inY) ) { return; }
+	gGRam[FBA(inX,inY)]=inColorRGB332;
+}
+// FNV-1a of GRAM (to compare the results of the drawing functions).
+uint32_t t2kPCGetGRamHash() {
+	uint32_t hash=2166136261u;
+	for(int i=0; i<kGRamWidth*kGRamHeight; i++) { hash=(hash^gGRam[i])*16777619u; }
+	return hash;
+}
+
+// ============================== sound ==============================
+
+const int kToneSeqQueueLength=32;	// same as t2kSCore.cpp
+
+struct ToneSeq {
+	int numOfTones;
+	uint32_t queuedMSec;
+	uint32_t playedMSec;
+};
+static ToneSeq gToneSeq[kNumOfChannels];
+static uint32_t gNumOfTones=0;		// notes (not rests) accepted by t2kAddToneEx
+
+bool t2kAddTone(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t inVolume) {
+	return t2kAddToneEx(inChannel,inFreqHz,inDurationMSec,inVolume,NULL);
+}
+bool t2kAddToneEx(uint8_t inChannel,float inFreqHz,int16_t inDurationMSec,uint8_t inVolume,
+				  const T2K_ToneModulation *inModulation) {
+	(void)inVolume;
+	(void)inModulation;
+	if(inChannel>=kNumOfChannels) { return false; }
+	ToneSeq *seq=gToneSeq+inChannel;
+	if(seq->numOfTones>=kToneSeqQueueLength) { return false; }
+	seq->numOfTones++;
+	if(inDurationMSec>0) { seq->queuedMSec+=inDurationMSec; }
+	if(inFreqHz>0) { gNumOfTones++; }
+	return true;
+}
+bool t2kStartToneSeq(uint8_t inChannel) {
+	return inChannel<kNumOfChannels;
+}
+bool t2kClearToneSeq(uint8_t inChannel) {
+	if(inChannel>=kNumOfChannels) { return false; }
+	memset(gToneSeq+inChannel,0,sizeof(ToneSeq));
+	return true;
+}
+uint32_t t2kGetToneSeqPlayedMSec(uint8_t inChannel) {
+	if(inChannel>=kNumOfChannels) { return 0; }
+	return gToneSeq[inChannel].playedMSec;
+}
+// t2kCacheMML is not supported (t2kCacheMML fails).
+bool t2kPlayPCM(uint8_t inChannel,const int8_t *inPCM,uint32_t inLength) {
+	(void)inChannel;
+	(void)inPCM;
+	(void)inLength;
+	return false;
+}
+bool t2kInitPCMRenderer(T2K_PCMRenderer *outRenderer,uint32_t inMSec) {
+	(void)inMSec;
+	memset(outRenderer,0,sizeof(T2K_PCMRenderer));
+	return false;
+}
+bool t2kRenderTone(T2K_PCMRenderer *ioRenderer,float inFreqHz,int16_t inDurationMSec,
+				   uint8_t inVolume,const T2K_ToneModulation *inModulation) {
+	(void)ioRenderer;
+	(void)inFreqHz;
+	(void)inDurationMSec;
+	(void)inVolume;
+	(void)inModulation;
+	return false;
+}
+
+void t2kPCPlayTones() {
+	for(int ch=0; ch<kNumOfChannels; ch++) {
+		ToneSeq *seq=gToneSeq+ch;
+		seq->playedMSec+=seq->queuedMSec;
+		seq->queuedMSec=0;
+		seq->numOfTones=0;
+	}
+}
+uint32_t t2kPCGetNumOfTones() {
+	return gNumOfTones;
+}
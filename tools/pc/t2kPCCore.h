@@ -0,0 +1,33 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// for the tools on the host PC (see t2kPCCore.cpp).
+
+#ifndef __T2K_PC_CORE_H__
+#define __T2K_PC_CORE_H__
+
+#include <stdint.h>
+#include <chrono>
+
+uint32_t t2kPCGetGRamHash();	// to compare the results of the drawing functions
+void t2kPCPlayTones();			// empty the tone queues
+uint32_t t2kPCGetNumOfTones();	// num of notes queued so far
+
+// [sec] from the first call.
+inline double t2kPCGetSec() {
+	static const std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+#endif
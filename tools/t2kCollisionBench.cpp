@@ -0,0 +1,117 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kCollisionBench - broad phase (t2kCollisionGrid) against all pairs on the host PC.
+//
+// build (on the host PC):
+//	g++ -O2 -DTEST_ON_PC -Iinclude -Itools/pc -o t2kCollisionBench
+//		tools/t2kCollisionBench.cpp tools/pc/t2kPCCore.cpp src/base/collision/t2kCollision.cpp
+//
+// usage:
+//	t2kCollisionBench [seed]
+//
+// 1k and 10k objects (95% of them are 4x4 bullets, the others are 16x16
+// enemies, and bullets are tested only against enemies) are put at random
+// in and around GRAM. each frame rebuilds the grid and finds the pairs.
+// the results are usec/frame of the grid and of testing all pairs, and the
+// num of pairs (they should be the same, or the exit code is 1).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <t2kCommon.h>
+#include <t2kCollision.h>
+#include "pc/t2kPCCore.h"
+
+const uint8_t kBullet=1;
+const uint8_t kEnemy=2;
+
+struct Object {
+	int left,top,right,bottom;
+	uint8_t category,mask;
+};
+
+static void countPair(int inIdA,int inIdB,void *ioContext);
+static int findAllPairs(const Object *inObjects,int inNum);
+
+int main(int argc,char *argv[]) {
+	srand(argc>1 ? atoi(argv[1]) : 1);
+	const int kNumOfFrames=100;
+	bool isAllSame=true;
+	static const int kNumOfObjects[]={ 1000,10000 };
+	for(int k=0; k<2; k++) {
+		const int n=kNumOfObjects[k];
+		if(t2kCollisionGridInit(n)==false) { return 1; }
+		Object *objects=(Object *)malloc(sizeof(Object)*n);
+		for(int i=0; i<n; i++) {
+			const bool isEnemy = i%20==0;
+			const int size = isEnemy ? 16 : 4;
+			objects[i].left=rand()%(kGRamWidth +size)-size/2;
+			objects[i].top =rand()%(kGRamHeight+size)-size/2;
+			objects[i].right =objects[i].left+size;
+			objects[i].bottom=objects[i].top +size;
+			objects[i].category = isEnemy ? kEnemy : kBullet;
+			objects[i].mask     = isEnemy ? kBullet : kEnemy;
+		}
+
+		int numOfPairs=0;
+		double t0=t2kPCGetSec();
+		for(int f=0; f<kNumOfFrames; f++) {
+			t2kCollisionGridClear();
+			for(int i=0; i<n; i++) {
+				const Object *o=objects+i;
+				t2kCollisionGridAdd(o->left,o->top,o->right,o->bottom,o->category,o->mask);
+			}
+			numOfPairs=0;
+			t2kCollisionGridFindPairs(countPair,&numOfPairs);
+		}
+		const double gridSec=(t2kPCGetSec()-t0)/kNumOfFrames;
+
+		int numOfAllPairs=0;
+		t0=t2kPCGetSec();
+		const int numOfAllFrames = n>1000 ? 1 : 10;
+		for(int f=0; f<numOfAllFrames; f++) { numOfAllPairs=findAllPairs(objects,n); }
+		const double allSec=(t2kPCGetSec()-t0)/numOfAllFrames;
+
+		const bool isSame = numOfPairs==numOfAllPairs;
+		isAllSame &= isSame;
+		printf("%5d objects: grid %8.1f usec/frame, all pairs %9.1f usec/frame, "
+			   "%d pairs %s\n",n,gridSec*1e6,allSec*1e6,numOfPairs,
+			   isSame ? "same" : "DIFFERENT");
+		free(objects);
+	}
+	return isAllSame ? 0 : 1;
+}
+
+static void countPair(int inIdA,int inIdB,void *ioContext) {
+	(void)inIdA;
+	(void)inIdB;
+	(*(int *)ioContext)++;
+}
+// O(n^2) reference.
+static int findAllPairs(const Object *inObjects,int inNum) {
+	int numOfPairs=0;
+	for(int i=0; i<inNum; i++) {
+		const Object *a=inObjects+i;
+		for(int j=i+1; j<inNum; j++) {
+			const Object *b=inObjects+j;
+			if((a->category & b->mask)==0 && (b->category & a->mask)==0) { continue; }
+			if(a->left<b->right && b->left<a->right && a->top<b->bottom && b->top<a->bottom) {
+				numOfPairs++;
+			}
+		}
+	}
+	return numOfPairs;
+}
@@ -0,0 +1,189 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kGlyphConv - convert the glyphs of a BDF font into a T2K_GlyphSet.
+//
+// build (on the host PC):
+//	g++ -O2 -o t2kGlyphConv tools/t2kGlyphConv.cpp
+//
+// usage:
+//	t2kGlyphConv font.bdf chars.txt name > name.h
+//
+// font.bdf should be an 8x8 (or smaller) font encoded in Unicode
+// (CHARSET_REGISTRY "ISO10646"). chars.txt is a UTF-8 text which has the
+// chars to be used (e.g. all kana and the kanji in the game's texts).
+// ASCII chars are skipped (they are in the t2k font), and so are the
+// chars out of the BMP.
+// the output defines 'const T2K_GlyphSet name', so include it in a .cpp
+// file and call t2kSetGlyphSet(&name).
+//
+// the glyphs are compressed as decompressGlyph in t2kFont.cpp: a byte of
+// flags (MSB is the top row) and the rows which differ from the row above.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <vector>
+
+struct Glyph {
+	uint8_t pattern[8];
+};
+
+static bool readBDF(const char *inPath,std::map<uint32_t,Glyph> *outGlyphs);
+static bool readChars(const char *inPath,std::set<uint32_t> *outCodepoints);
+static void compressGlyph(const Glyph& inGlyph,std::vector<uint8_t> *ioData);
+
+static void usage() {
+	fprintf(stderr,"usage: t2kGlyphConv font.bdf chars.txt name\n");
+	exit(1);
+}
+
+int main(int argc,char *argv[]) {
+	if(argc!=4) { usage(); }
+	const char *name=argv[3];
+	std::map<uint32_t,Glyph> glyphs;
+	std::set<uint32_t> codepoints;
+	if(readBDF(argv[1],&glyphs)==false) { return 1; }
+	if(readChars(argv[2],&codepoints)==false) { return 1; }
+
+	std::vector<uint16_t> usedCodepoints;
+	std::vector<uint16_t> offsets;
+	std::vector<uint8_t> data;
+	for(std::set<uint32_t>::iterator it=codepoints.begin(); it!=codepoints.end(); ++it) {
+		std::map<uint32_t,Glyph>::iterator glyph=glyphs.find(*it);
+		if(glyph==glyphs.end()) {
+			fprintf(stderr,"WARNING: U+%04X is not in the font.\n",*it);
+			continue;
+		}
+		usedCodepoints.push_back(*it);
+		offsets.push_back(data.size());
+		compressGlyph(glyph->second,&data);
+	}
+	if(data.size()>UINT16_MAX) {
+		fprintf(stderr,"ERROR: too many glyphs (%d bytes).\n",(int)data.size());
+		return 1;
+	}
+	const int n=usedCodepoints.size();
+	printf("// made by t2kGlyphConv: %d glyphs in %d bytes (%d bytes uncompressed)\n",
+		   n,(int)data.size(),n*8);
+	printf("static const uint16_t %s_codepoints[%d]={",name,n);
+	for(int k=0; k<n; k++) { printf("%s0x%04X,",k%12==0 ? "\n\t" : "",usedCodepoints[k]); }
+	printf("\n};\n");
+	printf("static const uint16_t %s_offsets[%d]={",name,n);
+	for(int k=0; k<n; k++) { printf("%s%d,",k%16==0 ? "\n\t" : "",offsets[k]); }
+	printf("\n};\n");
+	printf("static const uint8_t %s_data[%d]={",name,(int)data.size());
+	for(size_t k=0; k<data.size(); k++) { printf("%s0x%02X,",k%16==0 ? "\n\t" : "",data[k]); }
+	printf("\n};\n");
+	printf("const T2K_GlyphSet %s={ %d,%s_codepoints,%s_offsets,%s_data };\n",
+		   name,n,name,name,name);
+	return 0;
+}
+
+// the glyphs are put in the 8x8 cell by FONT_ASCENT and BBX. without
+// FONT_ASCENT, the ascent is the top of FONTBOUNDINGBOX (height + y offset).
+static bool readBDF(const char *inPath,std::map<uint32_t,Glyph> *outGlyphs) {
+	FILE *file=fopen(inPath,"r");
+	if(file==NULL) {
+		fprintf(stderr,"ERROR: can not open %s.\n",inPath);
+		return false;
+	}
+	char line[256];
+	int ascent=8;
+	bool hasFontAscent=false;
+	long encoding=-1;
+	int w=0,h=0,offsetX=0,offsetY=0;
+	while(fgets(line,sizeof(line),file)!=NULL) {
+		if(strncmp(line,"FONT_ASCENT ",12)==0) {
+			ascent=atoi(line+12);
+			hasFontAscent=true;
+		} else if(strncmp(line,"FONTBOUNDINGBOX ",16)==0) {
+			int fontW,fontH,fontOffsetX,fontOffsetY;
+			if(hasFontAscent==false
+			   && sscanf(line+16,"%d %d %d %d",&fontW,&fontH,&fontOffsetX,&fontOffsetY)==4) {
+				ascent=fontH+fontOffsetY;
+			}
+		} else if(strncmp(line,"ENCODING ",9)==0) {
+			encoding=atol(line+9);
+		} else if(strncmp(line,"BBX ",4)==0) {
+			sscanf(line+4,"%d %d %d %d",&w,&h,&offsetX,&offsetY);
+		} else if(strncmp(line,"BITMAP",6)==0) {
+			Glyph glyph;
+			memset(glyph.pattern,0,sizeof(glyph.pattern));
+			const int top=ascent-(offsetY+h);
+			bool isClipped=false;
+			for(int v=0; v<h && fgets(line,sizeof(line),file)!=NULL; v++) {
+				const uint32_t bits=strtoul(line,NULL,16);
+				const int numOfBits=(w+7)/8*8;
+				for(int u=0; u<w; u++) {
+					if((bits>>(numOfBits-1-u) & 1)==0) { continue; }
+					const int x=offsetX+u;
+					const int y=top+v;
+					if(x<0 || 8<=x || y<0 || 8<=y) {
+						isClipped=true;
+						continue;
+					}
+					glyph.pattern[y]|=0x80>>x;
+				}
+			}
+			if( isClipped ) {
+				fprintf(stderr,"WARNING: U+%04lX is larger than 8x8 (clipped).\n",encoding);
+			}
+			if(encoding>=0) { (*outGlyphs)[encoding]=glyph; }
+			encoding=-1;
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+static bool readChars(const char *inPath,std::set<uint32_t> *outCodepoints) {
+	FILE *file=fopen(inPath,"rb");
+	if(file==NULL) {
+		fprintf(stderr,"ERROR: can not open %s.\n",inPath);
+		return false;
+	}
+	int c;
+	while((c=fgetc(file))!=EOF) {
+		int n = c<0x80 ? 0 : (c & 0xE0)==0xC0 ? 1 : (c & 0xF0)==0xE0 ? 2
+			  : (c & 0xF8)==0xF0 ? 3 : -1;
+		if(n<0) { continue; }	// invalid byte
+		uint32_t codepoint=c & (0x7F>>n);
+		for(int i=0; i<n; i++) {
+			c=fgetc(file);
+			if(c==EOF || (c & 0xC0)!=0x80) { n=-1; break; }
+			codepoint=codepoint<<6 | (c & 0x3F);
+		}
+		if(n<=0 || 0xFFFF<codepoint) { continue; }
+		outCodepoints->insert(codepoint);
+	}
+	fclose(file);
+	return true;
+}
+
+static void compressGlyph(const Glyph& inGlyph,std::vector<uint8_t> *ioData) {
+	const size_t flagsPos=ioData->size();
+	ioData->push_back(0);
+	uint8_t prev=0;
+	for(int i=0; i<8; i++) {
+		if(inGlyph.pattern[i]!=prev) {
+			(*ioData)[flagsPos]|=0x80>>i;
+			ioData->push_back(inGlyph.pattern[i]);
+			prev=inGlyph.pattern[i];
+		}
+	}
+}
@@ -0,0 +1,158 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kMmlBench - MML parser throughput on the host PC.
+//
+// build (on the host PC):
+//	g++ -O2 -DTEST_ON_PC -DT2K_MML_NO_TRACE -Iinclude -Itools/pc -o t2kMmlBench
+//		tools/t2kMmlBench.cpp tools/pc/t2kPCCore.cpp src/base/mml/t2kMML.cpp
+//
+// usage:
+//	t2kMmlBench [sizeKB] [seed]	(the results are printed to stderr)
+//
+// a random MML of sizeKB (default 1024) is made, and
+//	check: t2kCheckMML parses all of it.
+//	play:  t2kPlayMML and t2kUpdateMML feed it to the tone queues of
+//		   4 channels (see tools/pc/t2kPCCore.cpp).
+// the results are MB/s of the MML string and notes/s.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+
+#include <t2kCommon.h>
+#include <t2kMML.h>
+#include <t2kSCore.h>
+#include "pc/t2kPCCore.h"
+
+static std::string makeMML(size_t inSize,int *outNumOfNotes,int *outNumOfPlayedNotes);
+
+int main(int argc,char *argv[]) {
+	const int sizeKB = argc>1 ? atoi(argv[1]) : 1024;
+	srand(argc>2 ? atoi(argv[2]) : 1);
+	if(sizeKB<=0) {
+		fprintf(stderr,"usage: t2kMmlBench [sizeKB] [seed]\n");
+		return 1;
+	}
+	t2kMmlInit();
+	int numOfNotes,numOfPlayedNotes;
+	const std::string mml=makeMML((size_t)sizeKB*1024,&numOfNotes,&numOfPlayedNotes);
+	const double mb=mml.size()/(1024.0*1024.0);
+
+	const int kNumOfChecks=5;
+	double t0=t2kPCGetSec();
+	for(int i=0; i<kNumOfChecks; i++) {
+		if(t2kCheckMML(mml.c_str())==false) {
+			fprintf(stderr,"ERROR: the generated MML is invalid.\n");
+			return 1;
+		}
+	}
+	double sec=(t2kPCGetSec()-t0)/kNumOfChecks;
+	fprintf(stderr,"check: %d KB, %d notes, %.2f msec, %.1f MB/s, %.2f M notes/s\n",
+			sizeKB,numOfNotes,sec*1000,mb/sec,numOfNotes/sec/1e6);
+
+	t0=t2kPCGetSec();
+	for(int ch=0; ch<kNumOfChannels; ch++) { t2kPlayMML(ch,mml.c_str()); }
+	int numOfUpdates=0;
+	for(bool isPlaying=true; isPlaying; numOfUpdates++) {
+		t2kUpdateMML();
+		t2kPCPlayTones();
+		isPlaying=false;
+		for(int ch=0; ch<kNumOfChannels; ch++) { isPlaying |= t2kGetMMLPosition(ch)>=0; }
+	}
+	sec=t2kPCGetSec()-t0;
+	const uint32_t numOfTones=t2kPCGetNumOfTones();
+	fprintf(stderr,"play:  %d channels, %u notes, %d updates, %.2f msec, %.1f MB/s, %.2f M notes/s\n",
+			kNumOfChannels,numOfTones,numOfUpdates,sec*1000,
+			mb*kNumOfChannels/sec,numOfTones/sec/1e6);
+	if(numOfTones!=(uint32_t)numOfPlayedNotes*kNumOfChannels) {
+		fprintf(stderr,"ERROR: %d notes are expected.\n",numOfPlayedNotes*kNumOfChannels);
+		return 1;
+	}
+	return 0;
+}
+
+// notes with lengths, accidentals and strengths, rests, octave, length,
+// tempo and effect commands, and up to 16 [ ... ]n loops. t2kCheckMML parses the
+// loops once, and t2kPlayMML plays them n times (outNumOfPlayedNotes).
+static std::string makeMML(size_t inSize,int *outNumOfNotes,int *outNumOfPlayedNotes) {
+	static const char *kLengths[]={ "","4","8","8.","16","12","24","32","8*0.5","4_" };
+	static const char *kAccidentals[]={ "","","+","-","=" };
+	static const char *kStrengths[]={ "","","",":+10",":-5","'" };
+	static const char *kEffects[]={ "@P30 ","@P= ","@~20,6 ","@~= ","@A4,7,40 ","@A= " };
+	const int numOfLengths=sizeof(kLengths)/sizeof(kLengths[0]);
+	const int numOfAccidentals=sizeof(kAccidentals)/sizeof(kAccidentals[0]);
+	const int numOfStrengths=sizeof(kStrengths)/sizeof(kStrengths[0]);
+	const int numOfEffects=sizeof(kEffects)/sizeof(kEffects[0]);
+	const int kMaxLoops=16;		// kMaxMmlLoops in t2kMML.cpp
+
+	std::string mml="T150 L8 O4 ";
+	int octave=4;
+	int numOfNotes=0;
+	int numOfPlayedNotes=0;
+	int numOfLoops=0;
+	char buf[32];
+	while(mml.size()<inSize) {
+		// a bar of notes, sometimes in a loop.
+		const int loopCount = numOfLoops<kMaxLoops && rand()%4==0 ? 2+rand()%3 : 1;
+		if(loopCount>1) {
+			mml+='[';
+			numOfLoops++;
+		}
+		const int octaveAtBar=octave;
+		int notesInBar=0;
+		for(int i=0; i<8; i++) {
+			const int r=rand()%16;
+			if(r==0 && octave<6) {
+				mml+='<';
+				octave++;
+			} else if(r==1 && octave>2) {
+				mml+='>';
+				octave--;
+			} else if(r==2) {
+				snprintf(buf,sizeof(buf),"r%s",kLengths[rand()%numOfLengths]);
+				mml+=buf;
+				continue;
+			} else if(r==3) {
+				snprintf(buf,sizeof(buf),"L%d ",1<<(2+rand()%3));
+				mml+=buf;
+			} else if(r==4) {
+				snprintf(buf,sizeof(buf),"T%d ",80+rand()%120);
+				mml+=buf;
+			} else if(r==5) {
+				mml+=kEffects[rand()%numOfEffects];
+			}
+			snprintf(buf,sizeof(buf),"%c%s%s%s",'a'+rand()%7,
+					 kAccidentals[rand()%numOfAccidentals],
+					 kLengths[rand()%numOfLengths],
+					 kStrengths[rand()%numOfStrengths]);
+			mml+=buf;
+			notesInBar++;
+		}
+		// back to the octave at the head of the bar (for the loops).
+		for(; octave<octaveAtBar; octave++) { mml+='<'; }
+		for(; octave>octaveAtBar; octave--) { mml+='>'; }
+		if(loopCount>1) {
+			snprintf(buf,sizeof(buf),"]%d",loopCount);
+			mml+=buf;
+		}
+		mml+=' ';
+		numOfNotes+=notesInBar;
+		numOfPlayedNotes+=notesInBar*loopCount;
+	}
+	*outNumOfNotes=numOfNotes;
+	*outNumOfPlayedNotes=numOfPlayedNotes;
+	return mml;
+}
@@ -0,0 +1,67 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kMmlFuzz - libFuzzer harness for the MML parser.
+//
+// build (on the host PC, clang):
+//	clang++ -g -O1 -DTEST_ON_PC -DT2K_MML_NO_TRACE -Iinclude -Itools/pc
+//		-fsanitize=fuzzer,address,undefined -o t2kMmlFuzz
+//		tools/t2kMmlFuzz.cpp tools/pc/t2kPCCore.cpp src/base/mml/t2kMML.cpp
+//
+// usage:
+//	t2kMmlFuzz -close_fd_mask=1 [corpus directory]
+//	(-close_fd_mask=1 hides the MML ERROR messages on stdout)
+//
+// the input is copied to a buffer of its own length plus '\0', so ASan
+// reports any read past the end of the MML string. the valid MMLs are also
+// played (with seek) for a while.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <t2kCommon.h>
+#include <t2kMML.h>
+#include <t2kSCore.h>
+#include "pc/t2kPCCore.h"
+
+const int kNumOfUpdates=64;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *inData,size_t inSize) {
+	static bool isInitialized=false;
+	if(isInitialized==false) {
+		t2kMmlInit();
+		isInitialized=true;
+	}
+	char *mml=(char *)malloc(inSize+1);
+	memcpy(mml,inData,inSize);
+	mml[inSize]='\0';
+	if(strlen(mml)>0 && t2kCheckMML(mml)) {
+		t2kPlayMML(0,mml);
+		for(int i=0; i<kNumOfUpdates && t2kGetMMLPosition(0)>=0; i++) {
+			t2kUpdateMML();
+			t2kPCPlayTones();
+		}
+		if(t2kSeekMML(0,inSize*10)) {
+			for(int i=0; i<kNumOfUpdates && t2kGetMMLPosition(0)>=0; i++) {
+				t2kUpdateMML();
+				t2kPCPlayTones();
+			}
+		}
+		t2kStopMML(0);
+	}
+	free(mml);
+	return 0;
+}
@@ -0,0 +1,149 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kSpriteBench - blit speed of the sprite formats on the host PC.
+//
+// build (on the host PC):
+//	g++ -O2 -DTEST_ON_PC -Iinclude -Itools/pc -o t2kSpriteBench
+//		tools/t2kSpriteBench.cpp tools/pc/t2kPCCore.cpp src/base/sprite/t2kSprite.cpp
+//
+// usage:
+//	t2kSpriteBench [numOfSprites] [seed]
+//
+// a 16x16 sprite (about 1/4 transparent) is drawn at random positions
+// (some of them are clipped) in each format. the results are ns/sprite
+// and the bitmap size. all formats should draw the same pixels as the
+// byte per pixel sprite ("same" in the result), or the exit code is 1.
+// then t2kPutSpriteAffine draws it rotating (0.01 rad per sprite) at some
+// scales (at scale 4 the bounding box is 64x64 to 90x90 pixels). angle 0 and scale 1 should
+// draw the same pixels as t2kPutSprite.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <t2kCommon.h>
+#include <t2kSprite.h>
+#include "pc/t2kPCCore.h"
+
+static const char *gPattern[]={
+	"____RRRRRRRR____",
+	"__RRRRRRRRRRRR__",
+	"_RRWWRRRRRRRRrr_",
+	"_RWWRRRRRRRRRrr_",
+	"RRWRRRRRYYRRRRrr",
+	"RRRRRRRYYYYRRRrr",
+	"RRRRRRYYkkYYRRrr",
+	"RRRRRRYkkkkYRRrr",
+	"RRRRRRYkkkkYRRrr",
+	"RRRRRRYYkkYYRRrr",
+	"RRRRRRRYYYYRRrrr",
+	"RRRRRRRRYYRRRrrr",
+	"_RRRRRRRRRRRrrr_",
+	"_RRRRRRRRRRrrrr_",
+	"__rrrrrrrrrrrr__",
+	"____rrrrrrrr____",
+};
+const int kWidth=16;
+const int kHeight=16;
+
+struct Position {
+	int x,y;
+};
+
+static double drawAll(T2K_Sprite16colors *inSprite,const Position *inPositions,int inNum);
+static double drawAllAffine(T2K_Sprite16colors *inSprite,const Position *inPositions,int inNum,
+							float inScale);
+
+int main(int argc,char *argv[]) {
+	const int numOfSprites = argc>1 ? atoi(argv[1]) : 1000000;
+	srand(argc>2 ? atoi(argv[2]) : 1);
+	if(numOfSprites<=0) {
+		fprintf(stderr,"usage: t2kSpriteBench [numOfSprites] [seed]\n");
+		return 1;
+	}
+	Position *positions=(Position *)malloc(sizeof(Position)*numOfSprites);
+	for(int i=0; i<numOfSprites; i++) {
+		positions[i].x=rand()%(kGRamWidth +kWidth) -kWidth/2;
+		positions[i].y=rand()%(kGRamHeight+kHeight)-kHeight/2;
+	}
+
+	const int kNumOfFormats=4;
+	static const char *kNames[kNumOfFormats]={
+		"byte per pixel","packed (4bpp)","byte per pixel + spans","packed (4bpp) + spans",
+	};
+	T2K_Sprite16colors sprite[kNumOfFormats];
+	t2kInitSprite(sprite+0,kWidth,kHeight,gPattern);
+	t2kInitPackedSprite(sprite+1,kWidth,kHeight,gPattern);
+	t2kInitSprite(sprite+2,kWidth,kHeight,gPattern);
+	t2kInitPackedSprite(sprite+3,kWidth,kHeight,gPattern);
+	t2kCompileSprite(sprite+2);
+	t2kCompileSprite(sprite+3);
+
+	bool isAllSame=true;
+	uint32_t refHash=0;
+	for(int i=0; i<kNumOfFormats; i++) {
+		t2kFill(0);
+		drawAll(sprite+i,positions,numOfSprites<1000 ? numOfSprites : 1000);
+		const uint32_t hash=t2kPCGetGRamHash();
+		if(i==0) { refHash=hash; }
+		const bool isSame = hash==refHash;
+		isAllSame &= isSame;
+
+		const double sec=drawAll(sprite+i,positions,numOfSprites);
+		const int bitmapBytes = sprite[i].spriteInfo.spriteType==kST_16colors_Packed
+							  ? (kWidth+1)/2*kHeight : kWidth*kHeight;
+		printf("%-24s %6.1f ns/sprite  bitmap %3d bytes  %s\n",kNames[i],
+			   sec*1e9/numOfSprites,bitmapBytes,isSame ? "same" : "DIFFERENT");
+	}
+
+	const int numOfAffines=numOfSprites/10;
+	static const float kScales[]={ 0.5f,1.0f,2.0f,4.0f };
+	for(int i=0; i<2; i++) {
+		t2kFill(0);
+		drawAll(sprite+i,positions,numOfSprites<1000 ? numOfSprites : 1000);
+		const uint32_t spriteHash=t2kPCGetGRamHash();
+		t2kFill(0);
+		for(int k=0; k<numOfSprites && k<1000; k++) {
+			t2kPutSpriteAffine(sprite+i,positions[k].x,positions[k].y,0,1);
+		}
+		const bool isSame = t2kPCGetGRamHash()==spriteHash;
+		isAllSame &= isSame;
+		printf("affine %-17s",kNames[i]);
+		for(int k=0; k<(int)(sizeof(kScales)/sizeof(kScales[0])); k++) {
+			const double sec=drawAllAffine(sprite+i,positions,numOfAffines,kScales[k]);
+			printf("  x%.1f %7.1f ns",kScales[k],sec*1e9/numOfAffines);
+		}
+		printf("  %s\n",isSame ? "same" : "DIFFERENT");
+	}
+
+	for(int i=0; i<kNumOfFormats; i++) { t2kFreeSprite(sprite+i); }
+	free(positions);
+	return isAllSame ? 0 : 1;
+}
+
+static double drawAll(T2K_Sprite16colors *inSprite,const Position *inPositions,int inNum) {
+	const double t0=t2kPCGetSec();
+	for(int i=0; i<inNum; i++) { t2kPutSprite(inSprite,inPositions[i].x,inPositions[i].y); }
+	return t2kPCGetSec()-t0;
+}
+static double drawAllAffine(T2K_Sprite16colors *inSprite,const Position *inPositions,int inNum,
+							float inScale) {
+	const double t0=t2kPCGetSec();
+	for(int i=0; i<inNum; i++) {
+		t2kPutSpriteAffine(inSprite,inPositions[i].x,inPositions[i].y,i*0.01f,inScale);
+	}
+	return t2kPCGetSec()-t0;
+}
@@ -0,0 +1,312 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kSpriteConv - convert a PPM image into const arrays for t2kInitSpriteFromROM.
+//
+// build (on the host PC):
+//	g++ -O2 -o t2kSpriteConv tools/t2kSpriteConv.cpp
+//
+// usage:
+//	t2kSpriteConv [options] input.ppm name > name.h
+//	options:
+//		-f numOfFrames	frames are stacked vertically in the image (default 1)
+//		-o x,y			origin of the sprite (default 0,0)
+//		-t RRGGBB		transparent color in hex (default none)
+//		-b				byte per pixel (default 4 bits per pixel)
+//		-256			RGB332 per pixel without palette
+//		-n				no spans (default: spans are made for 16 colors sprites)
+//
+// the colors are reduced to RGB332. 16 colors sprites can have 16 colors
+// including the transparent color, which is always the index color 0.
+// the output defines static arrays and 'const T2K_SpriteROM name', so
+// include it in a .cpp file and call t2kInitSpriteFromROM(&sprite,&name).
+//
+// the image should be PPM (P6 or P3). convert other formats with
+// netpbm or ImageMagick (e.g. "convert ship.png ship.ppm").
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+
+// same as t2kSprite.h
+enum SpriteType {
+	kST_16colors=1,
+	kST_16colors_Packed=2,
+	kST_256colors=3,
+};
+
+#define RGB(r,g,b) ( (((r)&0x07)<<5) | (((g)&0x07)<<2) | ((b) &0x03) )
+
+struct Image {
+	int width,height;
+	std::vector<uint8_t> rgb332;
+};
+
+static bool readPPM(const char *inPath,Image *outImage);
+static int readPPMValue(FILE *inFile,bool inIsBinary);
+static void makeSpans(const std::vector<uint8_t>& inIndex,int inWidth,int inNumOfRows,
+					  int inTransparentColor,std::vector<uint8_t> *outSpans);
+static void printBytes(const char *inName,const char *inSuffix,
+					   const std::vector<uint8_t>& inBytes,bool inIsAligned);
+
+static void usage() {
+	fprintf(stderr,"usage: t2kSpriteConv [-f numOfFrames] [-o x,y] [-t RRGGBB] "
+				   "[-b] [-256] [-n] input.ppm name\n");
+	exit(1);
+}
+
+int main(int argc,char *argv[]) {
+	int numOfFrames=1;
+	int originX=0,originY=0;
+	long transparentRGB=-1;
+	bool isPacked=true;
+	bool is256colors=false;
+	bool needSpans=true;
+	int i;
+	for(i=1; i<argc && argv[i][0]=='-'; i++) {
+		if(strcmp(argv[i],"-f")==0 && i+1<argc) {
+			numOfFrames=atoi(argv[++i]);
+		} else if(strcmp(argv[i],"-o")==0 && i+1<argc) {
+			if(sscanf(argv[++i],"%d,%d",&originX,&originY)!=2) { usage(); }
+		} else if(strcmp(argv[i],"-t")==0 && i+1<argc) {
+			transparentRGB=strtol(argv[++i],NULL,16);
+		} else if(strcmp(argv[i],"-b")==0) {
+			isPacked=false;
+		} else if(strcmp(argv[i],"-256")==0) {
+			is256colors=true;
+		} else if(strcmp(argv[i],"-n")==0) {
+			needSpans=false;
+		} else {
+			usage();
+		}
+	}
+	if(argc-i!=2) { usage(); }
+	const char *path=argv[i];
+	const char *name=argv[i+1];
+
+	Image image;
+	if(readPPM(path,&image)==false) { return 1; }
+	if(numOfFrames<1 || 255<numOfFrames || image.height%numOfFrames!=0) {
+		fprintf(stderr,"ERROR: the height %d is not a multiple of %d frames.\n",
+				image.height,numOfFrames);
+		return 1;
+	}
+	const int w=image.width;
+	const int h=image.height/numOfFrames;
+	const int numOfRows=image.height;
+	if(255<w || 255<h) {
+		fprintf(stderr,"ERROR: too large frame %dx%d (max 255x255).\n",w,h);
+		return 1;
+	}
+	if(originX<-128 || 127<originX || originY<-128 || 127<originY) {
+		fprintf(stderr,"ERROR: invalid origin (%d,%d).\n",originX,originY);
+		return 1;
+	}
+	int transparentColor=-1;	// RGB332
+	if(transparentRGB>=0) {
+		transparentColor=RGB((transparentRGB>>21) & 7,(transparentRGB>>13) & 7,
+							 (transparentRGB>>6) & 3);
+	}
+
+	// index colors (or RGB332 colors for 256 colors)
+	std::vector<uint8_t> index(w*numOfRows);
+	std::vector<uint8_t> palette;
+	int spriteType;
+	int transparentIndex;
+	if( is256colors ) {
+		spriteType=kST_256colors;
+		index=image.rgb332;
+		transparentIndex=transparentColor;
+	} else {
+		spriteType = isPacked ? kST_16colors_Packed : kST_16colors;
+		int paletteIndex[256];
+		memset(paletteIndex,-1,sizeof(paletteIndex));
+		if(transparentColor>=0) {
+			paletteIndex[transparentColor]=0;
+			palette.push_back(transparentColor);
+		}
+		for(int k=0; k<w*numOfRows; k++) {
+			const uint8_t c=image.rgb332[k];
+			if(paletteIndex[c]<0) {
+				if(palette.size()>=16) {
+					fprintf(stderr,"ERROR: more than 16 colors (RGB332) in %s.\n",path);
+					return 1;
+				}
+				paletteIndex[c]=palette.size();
+				palette.push_back(c);
+			}
+			index[k]=paletteIndex[c];
+		}
+		while(palette.size()<16) { palette.push_back(0); }
+		transparentIndex = transparentColor>=0 ? 0 : -1;
+	}
+	bool isOpaque=true;
+	for(int k=0; k<w*numOfRows; k++) {
+		if(index[k]==transparentIndex) { isOpaque=false; }
+	}
+
+	// bitmap
+	std::vector<uint8_t> bitmap;
+	if(spriteType==kST_16colors_Packed) {
+		const int bytesPerRow=(w+1)/2;
+		bitmap.assign(bytesPerRow*numOfRows,0);
+		for(int v=0; v<numOfRows; v++) {
+			for(int u=0; u<w; u++) {
+				bitmap[v*bytesPerRow+u/2] |= (u & 1)==0 ? index[v*w+u]<<4 : index[v*w+u];
+			}
+		}
+	} else {
+		bitmap=index;
+	}
+
+	// spans (same format as t2kCompileSprite)
+	std::vector<uint8_t> spans;
+	if(needSpans && spriteType!=kST_256colors) {
+		makeSpans(index,w,numOfRows,transparentIndex,&spans);
+		if(spans.size()>UINT16_MAX) {
+			fprintf(stderr,"ERROR: too large spans (%d bytes).\n",(int)spans.size());
+			return 1;
+		}
+	}
+
+	// collision mask (same format as t2kSprite.cpp)
+	const int wordsPerRow=(w+31)/32;
+	std::vector<uint32_t> mask(wordsPerRow*numOfRows,0);
+	for(int v=0; v<numOfRows; v++) {
+		for(int u=0; u<w; u++) {
+			if(index[v*w+u]!=transparentIndex) {
+				mask[v*wordsPerRow+u/32] |= 0x80000000u>>(u & 31);
+			}
+		}
+	}
+
+	printf("// made by t2kSpriteConv from %s\n",path);
+	printf("#include <t2kSprite.h>\n\n");
+	printBytes(name,"bitmap",bitmap,true);
+	if(palette.empty()==false) { printBytes(name,"palette",palette,false); }
+	if(spans.empty()==false) { printBytes(name,"spans",spans,true); }
+	printf("static const uint32_t %s_mask[%d]={",name,(int)mask.size());
+	for(size_t k=0; k<mask.size(); k++) {
+		printf("%s0x%08X,",k%8==0 ? "\n\t" : "",mask[k]);
+	}
+	printf("\n};\n");
+	printf("const T2K_SpriteROM %s={\n",name);
+	printf("\t%d,%d,%d,%d,%d,%d,%d,%s,\n",spriteType,w,h,numOfFrames,
+		   originX,originY,transparentIndex,isOpaque ? "true" : "false");
+	printf("\t%s_bitmap,\n",name);
+	printf("\t%s%s,\n",palette.empty() ? "NULL" : name,palette.empty() ? "" : "_palette");
+	printf("\t%s%s,\n",spans.empty() ? "NULL" : name,spans.empty() ? "" : "_spans");
+	printf("\t%s_mask,\n",name);
+	printf("};\n");
+	return 0;
+}
+
+static bool readPPM(const char *inPath,Image *outImage) {
+	FILE *file=fopen(inPath,"rb");
+	if(file==NULL) {
+		fprintf(stderr,"ERROR: can not open %s.\n",inPath);
+		return false;
+	}
+	char magic[3]={0};
+	bool result=false;
+	if(fread(magic,1,2,file)!=2 || magic[0]!='P' || (magic[1]!='6' && magic[1]!='3')) {
+		fprintf(stderr,"ERROR: %s is not a PPM (P6 or P3) file.\n",inPath);
+	} else {
+		const bool isBinary=magic[1]=='6';
+		const int width =readPPMValue(file,false);
+		const int height=readPPMValue(file,false);
+		const int maxValue=readPPMValue(file,false);
+		if(width<=0 || height<=0 || maxValue<=0 || 255<maxValue) {
+			fprintf(stderr,"ERROR: invalid PPM header in %s.\n",inPath);
+		} else {
+			// the white space after the header was consumed by readPPMValue.
+			outImage->width=width;
+			outImage->height=height;
+			outImage->rgb332.resize(width*height);
+			result=true;
+			for(int k=0; k<width*height && result; k++) {
+				int c[3];
+				for(int j=0; j<3; j++) {
+					c[j]=readPPMValue(file,isBinary);
+					if(c[j]<0) {
+						fprintf(stderr,"ERROR: unexpected end of %s.\n",inPath);
+						result=false;
+						break;
+					}
+					c[j]=c[j]*255/maxValue;
+				}
+				outImage->rgb332[k]=RGB(c[0]>>5,c[1]>>5,c[2]>>6);
+			}
+		}
+	}
+	fclose(file);
+	return result;
+}
+// return -1 at the end of file.
+static int readPPMValue(FILE *inFile,bool inIsBinary) {
+	if( inIsBinary ) {
+		int c=fgetc(inFile);
+		return c==EOF ? -1 : c;
+	}
+	int c=fgetc(inFile);
+	while(c=='#' || isspace(c)) {
+		if(c=='#') {
+			while(c!='\n' && c!=EOF) { c=fgetc(inFile); }
+		}
+		c=fgetc(inFile);
+	}
+	if(isdigit(c)==false) { return -1; }
+	int value=0;
+	for(; isdigit(c); c=fgetc(inFile)) { value=value*10+c-'0'; }
+	// the following white space is consumed here.
+	return value;
+}
+
+static void makeSpans(const std::vector<uint8_t>& inIndex,int inWidth,int inNumOfRows,
+					  int inTransparentColor,std::vector<uint8_t> *outSpans) {
+	std::vector<uint8_t>& spans=*outSpans;
+	spans.assign(sizeof(uint16_t)*inNumOfRows,0);
+	for(int v=0; v<inNumOfRows; v++) {
+		const uint8_t *row=&inIndex[v*inWidth];
+		const int offset=spans.size();
+		spans[v*2  ]=offset & 0xFF;		// little endian uint16_t
+		spans[v*2+1]=offset>>8;
+		const int numOfSpansPos=spans.size();
+		spans.push_back(0);
+		int prevEnd=0;
+		for(int u=0; u<inWidth; ) {
+			if(row[u]==inTransparentColor) { u++; continue; }
+			spans.push_back(u-prevEnd);
+			const int lengthPos=spans.size();
+			spans.push_back(0);
+			for(; u<inWidth && row[u]!=inTransparentColor; u++) { spans.push_back(row[u]); }
+			spans[lengthPos]=spans.size()-(lengthPos+1);
+			prevEnd=u;
+			spans[numOfSpansPos]++;
+		}
+	}
+}
+
+static void printBytes(const char *inName,const char *inSuffix,
+					   const std::vector<uint8_t>& inBytes,bool inIsAligned) {
+	printf("static const uint8_t %s_%s[%d]%s={",inName,inSuffix,(int)inBytes.size(),
+		   inIsAligned ? " __attribute__((aligned(4)))" : "");
+	for(size_t k=0; k<inBytes.size(); k++) {
+		printf("%s0x%02X,",k%16==0 ? "\n\t" : "",inBytes[k]);
+	}
+	printf("\n};\n");
+}
@@ -0,0 +1,179 @@
+// t2k - Tatsuko Driver is a software library designed to drive game development.
+// Copyright (C) Damako Soft since 2020, all rights reserved.
+// current version is ver. 0.1.
+//
+// Damako Soft staff:
+// 	Da: Daizo Sasaki
+// 	Ma: yoshiMasa Sugawara
+// 	Ko: Koji Saito
+//
+// If you are interested in t2k, please follow our Twitter account @DamakoSoft
+//
+// These software come with absolutory no warranty and are released under the
+// MIT License.  see https://opensource.org/licenses/MIT
+
+// t2kTilemapBench - tilemap drawing speed on the host PC.
+//
+// build (on the host PC):
+//	g++ -O2 -DTEST_ON_PC -Iinclude -Itools/pc -o t2kTilemapBench tools/t2kTilemapBench.cpp
+//		tools/pc/t2kPCCore.cpp src/base/sprite/t2kSprite.cpp src/base/tilemap/t2kTilemap.cpp
+//
+// usage:
+//	t2kTilemapBench [numOfFrames] [seed]
+//
+// 3 parallax layers are drawn for each frame with their own scroll:
+//	far:  16x16 opaque tiles (packed)
+//	mid:  8x8 tiles with transparent pixels (byte per pixel)
+//	near: 16x16 mostly empty tiles with some mixed ones (packed), not loop
+// the results are usec/frame of each layer and of all. before that, the
+// layers are compared with a pixel by pixel reference at many scrolls
+// ("same" in the result), or the exit code is 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <t2kCommon.h>
+#include <t2kSprite.h>
+#include <t2kTilemap.h>
+#include "pc/t2kPCCore.h"
+
+static const char *gTiles16[]={
+	// 0: opaque
+	"BBBBBBBBBBBBBBBB","BbbbbbbbbbbbbbbB","BbBBBBBBBBBBBBbB","BbBbbbbbbbbbbBbB",
+	"BbBbBBBBBBBBbBbB","BbBbBbbbbbbBbBbB","BbBbBbBBBBbBbBbB","BbBbBbBkkBbBbBbB",
+	"BbBbBbBkkBbBbBbB","BbBbBbBBBBbBbBbB","BbBbBbbbbbbBbBbB","BbBbBBBBBBBBbBbB",
+	"BbBbbbbbbbbbbBbB","BbBBBBBBBBBBBBbB","BbbbbbbbbbbbbbbB","BBBBBBBBBBBBBBBB",
+	// 1: opaque
+	"cccccccccccccccc","cCCCCCCCCCCCCCCc","cCccccccccccccCc","cCcCCCCCCCCCCcCc",
+	"cCcCccccccccCcCc","cCcCcCCCCCCcCcCc","cCcCcCccccCcCcCc","cCcCcCcWWcCcCcCc",
+	"cCcCcCcWWcCcCcCc","cCcCcCccccCcCcCc","cCcCcCCCCCCcCcCc","cCcCccccccccCcCc",
+	"cCcCCCCCCCCCCcCc","cCccccccccccccCc","cCCCCCCCCCCCCCCc","cccccccccccccccc",
+	// 2: empty
+	"________________","________________","________________","________________",
+	"________________","________________","________________","________________",
+	"________________","________________","________________","________________",
+	"________________","________________","________________","________________",
+	// 3: mixed
+	"______GGGG______","____GGGGGGGG____","___GGGGGGGGGG___","__GGGGgGGGGGGG__",
+	"__GGGggGGGGGGG__","_GGGGGGGGGgGGGG_","_GGGGGGGGggGGGG_","GGGgGGGGGGGGGGGG",
+	"GGGggGGGGGGGGGGG","_GGGGGGGGGGGGgG_","_GGGGGGGGGGGggG_","__GGGGGGGGGGGG__",
+	"__GGGGGyyGGGGG__","___GGGGyyGGGG___","______yyyy______","______yyyy______",
+};
+static const char *gTiles8[]={
+	// 0: mixed
+	"___YY___","__YYYY__","_YYWWYY_","YYWWWWYY","YYWWWWYY","_YYWWYY_","__YYYY__","___YY___",
+	// 1: empty
+	"________","________","________","________","________","________","________","________",
+	// 2: mixed
+	"RR____RR","R______R","________","___RR___","___RR___","________","R______R","RR____RR",
+};
+
+static uint8_t gRef[kGRamWidth*kGRamHeight];
+
+static void drawReference(const T2K_Tilemap *inTilemap);
+static int getIndexColor(const T2K_Sprite16colors *inSprite,int inU,int inV);
+
+int main(int argc,char *argv[]) {
+	const int numOfFrames = argc>1 ? atoi(argv[1]) : 10000;
+	srand(argc>2 ? atoi(argv[2]) : 1);
+	if(numOfFrames<=0) {
+		fprintf(stderr,"usage: t2kTilemapBench [numOfFrames] [seed]\n");
+		return 1;
+	}
+	T2K_Sprite16colors tiles16,tiles8;
+	t2kInitSpriteSheet(&tiles16,16,16,4,gTiles16,0,0,false,NULL,NULL,true);
+	t2kInitSpriteSheet(&tiles8,8,8,3,gTiles8);
+
+	const int kFarWidth=32,kFarHeight=16;
+	const int kMidWidth=64,kMidHeight=32;
+	const int kNearWidth=128,kNearHeight=16;
+	static uint8_t farMap[kFarWidth*kFarHeight];
+	static uint8_t midMap[kMidWidth*kMidHeight];
+	static uint8_t nearMap[kNearWidth*kNearHeight];
+	for(int i=0; i<kFarWidth*kFarHeight; i++) { farMap[i]=rand()%2; }
+	for(int i=0; i<kMidWidth*kMidHeight; i++) { midMap[i]=rand()%3; }
+	for(int i=0; i<kNearWidth*kNearHeight; i++) { nearMap[i] = rand()%4==0 ? 3 : 2; }
+
+	const int kNumOfLayers=3;
+	static const char *kNames[kNumOfLayers]={ "far","mid","near" };
+	T2K_Tilemap layer[kNumOfLayers];
+	t2kInitTilemap(layer+0,&tiles16,farMap,kFarWidth,kFarHeight);
+	t2kInitTilemap(layer+1,&tiles8,midMap,kMidWidth,kMidHeight);
+	t2kInitTilemap(layer+2,&tiles16,nearMap,kNearWidth,kNearHeight,false);
+
+	bool isAllSame=true;
+	for(int i=0; i<kNumOfLayers; i++) {
+		bool isSame=true;
+		for(int k=0; k<500 && isSame; k++) {
+			t2kSetTilemapScroll(layer+i,rand()%2000-1000,rand()%600-300);
+			t2kFill(0x5A);
+			memset(gRef,0x5A,sizeof(gRef));
+			t2kPutTilemap(layer+i);
+			drawReference(layer+i);
+			isSame = memcmp(gRef,t2kGetFramebuffer(),sizeof(gRef))==0;
+		}
+		isAllSame &= isSame;
+		printf("%-4s %s\n",kNames[i],isSame ? "same" : "DIFFERENT");
+	}
+
+	// the near layer (not loop) scrolls inside its map, so it is drawn in every frame.
+	const int kNearScrollWidth=kNearWidth*16-kGRamWidth;
+	const int kNearScrollHeight=kNearHeight*16-kGRamHeight;
+	double sec[kNumOfLayers]={ 0,0,0 };
+	for(int f=0; f<numOfFrames; f++) {
+		for(int i=0; i<kNumOfLayers; i++) {
+			if(layer[i].isLoop) {
+				t2kSetTilemapScroll(layer+i,f*(i+1)/2,f/4-i*8);
+			} else {
+				t2kSetTilemapScroll(layer+i,f*(i+1)/2%kNearScrollWidth,f/4%kNearScrollHeight);
+			}
+			const double t0=t2kPCGetSec();
+			t2kPutTilemap(layer+i);
+			sec[i]+=t2kPCGetSec()-t0;
+		}
+	}
+	double total=0;
+	for(int i=0; i<kNumOfLayers; i++) {
+		printf("%-4s %6.1f usec/frame\n",kNames[i],sec[i]*1e6/numOfFrames);
+		total+=sec[i];
+	}
+	printf("all  %6.1f usec/frame\n",total*1e6/numOfFrames);
+	t2kFreeSprite(&tiles16);
+	t2kFreeSprite(&tiles8);
+	return isAllSame ? 0 : 1;
+}
+
+// pixel by pixel, from the map coordinates of each GRAM pixel.
+static void drawReference(const T2K_Tilemap *inTilemap) {
+	const T2K_Sprite16colors *tileSet=inTilemap->tileSet;
+	const int size=inTilemap->tileSize;
+	const int mapW=inTilemap->mapWidth*size;
+	const int mapH=inTilemap->mapHeight*size;
+	for(int y=0; y<kGRamHeight; y++) {
+		for(int x=0; x<kGRamWidth; x++) {
+			int u=inTilemap->scrollX+x;
+			int v=inTilemap->scrollY+y;
+			if( inTilemap->isLoop ) {
+				u=(u%mapW+mapW)%mapW;
+				v=(v%mapH+mapH)%mapH;
+			} else if(u<0 || v<0 || mapW<=u || mapH<=v) {
+				continue;
+			}
+			const int tileNo=inTilemap->map[v/size*inTilemap->mapWidth+u/size];
+			if(tileNo>=tileSet->spriteInfo.numOfFrames) { continue; }
+			const int c=getIndexColor(tileSet,u%size,tileNo*size+v%size);
+			if(c==tileSet->spriteInfo.transparentColor) { continue; }
+			gRef[FBA(x,y)]=tileSet->palette[c];
+		}
+	}
+}
+static int getIndexColor(const T2K_Sprite16colors *inSprite,int inU,int inV) {
+	const int w=inSprite->spriteInfo.width;
+	if(inSprite->spriteInfo.spriteType==kST_16colors_Packed) {
+		const uint8_t pair=inSprite->bitmap[inV*((w+1)/2)+inU/2];
+		return (inU & 1)==0 ? pair>>4 : pair & 0x0F;
+	}
+	return inSprite->bitmap[inV*w+inU];
+}